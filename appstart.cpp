@@ -3,24 +3,140 @@
 // Copyright Matthew Chandler 2014
 
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include <cstdint>
 #include <cstdlib>
-#include <ctime>
 
 #include <gtkmm/application.h>
 
+#include "cli.h"
+#include "engine.h"
 #include "gui.h"
+#include "timeline.h"
+#include "trace.h"
 
 int main(int argc, char * argv[])
 {
-    // initialize random seed
-    srand(time(0));
+    // seed for the sequence of games. random unless given with --seed
+    std::uint64_t seed = Mancala::random_seed();
+    // file to record games to, if any
+    std::string record_path;
+
+    // command line modes. the GUI is started if none are given
+    bool scan_records = false, analyse = false, engine = false, solve = false, bench = false, selfplay = false,
+        fuzz = false;
+    std::string scan_records_path, analyse_path, engine_socket_path, solve_path, checkpoint_path;
+    int threads = 0, depth = 10, movetime_ms = 0, hash_mb = 256, checkpoint_secs = 60, games = 20,
+        fuzz_games = 100000;
+
+    // pull out our own options, pass the rest on to GTK
+    std::vector<char *> gtk_argv;
+    for(int i = 0; i < argc; ++i)
+    {
+        if(std::string(argv[i]) == "--startup-times")
+            Mancala::startup_timeline.enabled = true;
+        else if(std::string(argv[i]) == "--trace" && i + 1 < argc)
+            Mancala::trace.enable(argv[++i]);
+        else if(std::string(argv[i]) == "--seed" && i + 1 < argc)
+            seed = std::strtoull(argv[++i], NULL, 0);
+        else if(std::string(argv[i]) == "--record" && i + 1 < argc)
+            record_path = argv[++i];
+        else if(std::string(argv[i]) == "--scan-records" && i + 1 < argc)
+        {
+            scan_records = true;
+            scan_records_path = argv[++i];
+        }
+        else if(std::string(argv[i]) == "--analyse")
+        {
+            analyse = true;
+            // file is optional, defaulting to stdin
+            if(i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+                analyse_path = argv[++i];
+        }
+        else if(std::string(argv[i]) == "--solve")
+        {
+            solve = true;
+            if(i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+                solve_path = argv[++i];
+        }
+        else if(std::string(argv[i]) == "--hash" && i + 1 < argc)
+            hash_mb = std::atoi(argv[++i]);
+        else if(std::string(argv[i]) == "--checkpoint" && i + 1 < argc)
+            checkpoint_path = argv[++i];
+        else if(std::string(argv[i]) == "--checkpoint-interval" && i + 1 < argc)
+            checkpoint_secs = std::atoi(argv[++i]);
+        else if(std::string(argv[i]) == "--bench")
+            bench = true;
+        else if(std::string(argv[i]) == "--selfplay")
+        {
+            selfplay = true;
+            if(i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+                games = std::atoi(argv[++i]);
+        }
+        else if(std::string(argv[i]) == "--fuzz")
+        {
+            fuzz = true;
+            if(i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+                fuzz_games = std::atoi(argv[++i]);
+        }
+        else if(std::string(argv[i]) == "--engine")
+            engine = true;
+#ifndef _WIN32
+        else if(std::string(argv[i]) == "--engine-socket" && i + 1 < argc)
+        {
+            engine = true;
+            engine_socket_path = argv[++i];
+        }
+#endif
+        else if(std::string(argv[i]) == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if(std::string(argv[i]) == "--depth" && i + 1 < argc)
+            depth = std::atoi(argv[++i]);
+        else if(std::string(argv[i]) == "--movetime" && i + 1 < argc)
+            movetime_ms = std::atoi(argv[++i]);
+        else
+            gtk_argv.push_back(argv[i]);
+    }
+
+    if(scan_records)
+        return Mancala::scan_records(scan_records_path);
+    if(analyse)
+        return Mancala::analyse(analyse_path, threads, depth, movetime_ms);
+    if(bench)
+        return Mancala::bench(depth);
+    if(selfplay)
+        return Mancala::selfplay(games, depth);
+    if(fuzz)
+        return Mancala::fuzz(fuzz_games, seed);
+    if(solve)
+        return Mancala::solve(solve_path, threads, hash_mb, checkpoint_path, checkpoint_secs);
+    if(engine)
+    {
+#ifndef _WIN32
+        if(!engine_socket_path.empty())
+            return Mancala::run_engine_socket(engine_socket_path, depth);
+#endif
+        return Mancala::run_engine(depth);
+    }
+
+    int gtk_argc = gtk_argv.size();
+    gtk_argv.push_back(NULL);
+    char ** gtk_argv_p = gtk_argv.data();
+
+    Mancala::startup_timeline.mark("main");
+    Mancala::trace.name_thread("GUI");
 
     // set up and launch a GTK window
-    Glib::RefPtr<Gtk::Application> app = Gtk::Application::create(argc, argv,
+    Glib::RefPtr<Gtk::Application> app = Gtk::Application::create(gtk_argc, gtk_argv_p,
         "org.matt.mancala", Gio::APPLICATION_NON_UNIQUE);
 
-    Mancala::Win m_win;
+    Mancala::startup_timeline.mark("GTK initialized");
+
+    Mancala::Win m_win(seed, record_path);
+
+    Mancala::startup_timeline.mark("main window constructed");
 
     return app->run(m_win);
 }
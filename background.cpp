@@ -0,0 +1,197 @@
+// background.cpp
+// AI searches run ahead of time on a background thread
+// Copyright Matthew Chandler 2014
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "background.h"
+#include "trace.h"
+
+namespace Mancala
+{
+    // drop the cache when it gets this large
+    const size_t MAX_CACHE_SIZE = 10000;
+
+    Background_job::Background_job(const Simple_board & B, const Player P, const int Depth):
+        board(B), player(P), depth(Depth)
+    {}
+
+    Background_search::Background_search():
+        stop(false),
+        quitting(false)
+    {
+        running_result.depth = -1;
+        thread = std::thread(&Background_search::thread_func, this);
+    }
+
+    // stops the running search, and waits for it
+    Background_search::~Background_search()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.clear();
+            stop = true;
+            quitting = true;
+        }
+        cv.notify_all();
+        thread.join();
+    }
+
+    // replace the queued searches with jobs, skipping any already cached
+    void Background_search::replace(const std::vector<Background_job> & jobs)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.clear();
+            bool keep_running = false;
+            for(auto & job: jobs)
+            {
+                Key key = make_key(job);
+                // a running search that's already been told to stop can't be kept. run it again instead
+                if(key == running && !stop)
+                    keep_running = true;
+                else if(!cache.count(key))
+                    queue.push_back(canonical(job));
+            }
+            if(!running.empty() && !keep_running)
+                stop = true;
+        }
+        cv.notify_all();
+    }
+
+    // drop queued searches and stop the running one, other than job
+    void Background_search::keep(const Background_job & job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Key key = make_key(job);
+        bool queued = false;
+        for(auto & queued_job: queue)
+            if(make_key(queued_job) == key)
+                queued = true;
+        queue.clear();
+        // a running search that's already been told to stop won't be cached, so run it again
+        if(queued || (running == key && stop))
+            queue.push_back(canonical(job));
+        if(!running.empty() && running != key)
+            stop = true;
+    }
+
+    // drop queued searches and stop the running one
+    void Background_search::cancel()
+    {
+        replace(std::vector<Background_job>());
+    }
+
+    // drop cached results
+    void Background_search::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache.clear();
+    }
+
+    // get a finished result. returns false if it isn't cached
+    bool Background_search::find(const Background_job & job, Search_result & result, const bool partial) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Key key = make_key(job);
+        auto it = cache.find(key);
+        if(it != cache.end())
+            result = it->second;
+        else if(partial && key == running && running_result.depth >= 0)
+            result = running_result;
+        else
+            return false;
+
+        // results are for the canonical position
+        if(job.player == PLAYER_2)
+            swap_moves(result.moves, job.board.num_bowls);
+        return true;
+    }
+
+    // is the search queued or running
+    bool Background_search::pending(const Background_job & job) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Key key = make_key(job);
+        if(key == running)
+            return true;
+        for(auto & queued: queue)
+            if(make_key(queued) == key)
+                return true;
+        return false;
+    }
+
+    // the same search for player 1, after swapping sides if needed
+    Background_job Background_search::canonical(const Background_job & job)
+    {
+        Background_job swapped = job;
+        if(job.player == PLAYER_2)
+        {
+            swapped.board.swap_sides();
+            swapped.player = PLAYER_1;
+        }
+        return swapped;
+    }
+
+    // cache key: canonical counts, then rules and depth
+    Background_search::Key Background_search::make_key(const Background_job & job)
+    {
+        Background_job swapped = canonical(job);
+        Key key;
+        key.reserve(swapped.board.bowls.size() + 2);
+        for(auto & bowl: swapped.board.bowls)
+            key.push_back(bowl.count);
+        key.push_back(swapped.board.extra_rule | swapped.board.capture_rule << 1 | swapped.board.collect_rule << 2);
+        key.push_back(swapped.depth);
+        return key;
+    }
+
+    void Background_search::thread_func()
+    {
+#ifdef __linux__
+        // stay out of the way of the GUI and the AI's own searches. Linux applies nice values per thread
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+#endif
+        trace.name_thread("background search");
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            {
+                Trace_span span("queue wait");
+                cv.wait(lock, [this]{ return !queue.empty() || quitting; });
+            }
+            if(quitting)
+                return;
+
+            Background_job job = queue.front();
+            queue.pop_front();
+            running = make_key(job);
+            running_result.depth = -1;
+            stop = false;
+            lock.unlock();
+
+            // searching with a stop flag deepens one step at a time, but the final result is the same
+            Search_limits limits(job.depth, 0, &stop);
+            limits.on_depth = [this](const Search_result & result)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running_result = result;
+            };
+            Search_result result = search(job.board, job.player, limits);
+
+            lock.lock();
+            if(!stop)
+            {
+                if(cache.size() >= MAX_CACHE_SIZE)
+                    cache.clear();
+                cache[running] = result;
+            }
+            running.clear();
+        }
+    }
+}
@@ -0,0 +1,79 @@
+// background.h
+// AI searches run ahead of time on a background thread
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_BACKGROUND_H
+#define MANCALA_BACKGROUND_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "search.h"
+
+namespace Mancala
+{
+    // a position to search
+    struct Background_job
+    {
+        Background_job(const Simple_board & B, const Player P, const int Depth);
+
+        Simple_board board;
+        Player player;
+        int depth;
+    };
+
+    // searches positions one at a time on a low priority background thread, caching the results by position
+    // player 2's positions are cached as the same position for player 1 (see Simple_board::swap_sides),
+    // so mirrored positions share one search
+    class Background_search
+    {
+    public:
+        Background_search();
+        // stops the running search, and waits for it
+        ~Background_search();
+
+        // replace the queued searches with jobs, skipping any already cached
+        // the running search carries on if it's one of jobs, and is stopped otherwise
+        void replace(const std::vector<Background_job> & jobs);
+        // drop queued searches and stop the running one, other than job. job isn't started if it's not pending
+        void keep(const Background_job & job);
+        // drop queued searches and stop the running one
+        void cancel();
+        // drop cached results
+        void clear();
+
+        // get a finished result. returns false if it isn't cached
+        // if partial is set and the job is running, its deepest completed look-ahead is returned instead
+        bool find(const Background_job & job, Search_result & result, const bool partial = false) const;
+        // is the search queued or running
+        bool pending(const Background_job & job) const;
+
+    private:
+        // the same search for player 1, after swapping sides if needed
+        static Background_job canonical(const Background_job & job);
+        // cache key: canonical counts, then rules and depth
+        typedef std::vector<int> Key;
+        static Key make_key(const Background_job & job);
+
+        void thread_func();
+
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Background_job> queue;
+        std::map<Key, Search_result> cache;
+        // key of the running search. empty when idle
+        Key running;
+        // deepest completed look-ahead of the running search. depth is -1 until the first completes
+        Search_result running_result;
+        std::atomic<bool> stop;
+        bool quitting;
+        std::thread thread;
+    };
+}
+
+#endif // MANCALA_BACKGROUND_H
@@ -5,11 +5,14 @@
 #ifndef MANCALA_BOARD_H
 #define MANCALA_BOARD_H
 
+#include <cstdint>
 #include <thread>
 #include <vector>
 
 #include <sigc++/sigc++.h>
 
+#include "rng.h"
+
 namespace Mancala
 {
     enum Player {PLAYER_1, PLAYER_2};
@@ -33,7 +36,7 @@ namespace Mancala
     {
     public:
         Bowl(const int Count = 0, const std::vector<double> & Ul = std::vector<double>({0.0, 0.0}),
-        const double Width = 1.0, const double Height = 1.0);
+        const double Width = 1.0, const double Height = 1.0, Rng * Rng_ptr = NULL);
 
         // add a new bead
         void add_bead(const Mancala::Bead & new_bead);
@@ -49,6 +52,21 @@ namespace Mancala
 
         Bowl * next;
         Bowl * across;
+
+        // generator for bead positions and colors. owned by the board
+        Rng * rng;
+    };
+
+    // record of a bead placed by Board::move, used to animate sowing
+    struct Sow_step
+    {
+        // bowl the bead landed in, and its index in that bowl
+        const Bowl * bowl;
+        size_t bead_i;
+        // bead position before the move
+        std::vector<double> from;
+        // order the bead was placed in. beads captured or collected together share a step
+        int step;
     };
 
     // Board data
@@ -56,7 +74,8 @@ namespace Mancala
     {
     public:
         Board(const int Num_bowls = 6, const int Num_beads = 4, const int Ai_depth = 10,
-            const bool Extra_rule = true, const bool Capture_rule = true, const bool Collect_rule = true);
+            const bool Extra_rule = true, const bool Capture_rule = true, const bool Collect_rule = true,
+            const std::uint64_t Seed = 0);
         Board(const Board & b);
         Board & operator=(const Board & b);
     public:
@@ -65,6 +84,7 @@ namespace Mancala
 
         // perform a move
         // returns true if the move earns an extra turn
+        // each bowl modified is appended to changed_bowls, and each bead placed to sow_log
         bool move(const Mancala::Player p, const int i);
 
         // is the game over
@@ -75,6 +95,8 @@ namespace Mancala
 
         // ai method to choose the best move based on evaluate()
         int choosemove(const Mancala::Player p) const;
+        // pick between equally good moves, as choosemove does. the choice depends only on the seed and position
+        int pick_move(const Mancala::Player p, const std::vector<int> & moves) const;
         // non-blocking version
         // emits signal with int when complete
         // return id of thread, to be matched with signal
@@ -92,13 +114,29 @@ namespace Mancala
         // disable / enable rules
         bool extra_rule, capture_rule, collect_rule;
 
+        // seed for this game. the bead layout and the AI's choice between equal moves depend only on this
+        std::uint64_t seed;
+        // generator for the bead layout, reseeded by set_bowls
+        Rng rng;
+
         // board layout vars
         std::vector<Bowl> top_row;
         std::vector<Bowl> bottom_row;
         Bowl l_store;
         Bowl r_store;
 
+        // bowls modified by move() since this was last cleared
+        // not copied with the board
+        std::vector<const Bowl *> changed_bowls;
+        // beads placed by move() since this was last cleared
+        // not copied with the board
+        std::vector<Sow_step> sow_log;
+
         signal_choosemove_t signal_choosemove_sig;
+
+    private:
+        // add a bead to a bowl, and log it to sow_log
+        void place_bead(Bowl & bowl, const Bead & bead, const int step);
     };
 }
 
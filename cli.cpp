@@ -0,0 +1,652 @@
+// cli.cpp
+// command line (non-GUI) modes
+// Copyright Matthew Chandler 2014
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "cli.h"
+#include "fixed_board.h"
+#include "record.h"
+#include "search.h"
+#include "solver.h"
+#include "trace.h"
+
+namespace Mancala
+{
+    // read every game in a record file, and report how many were read and how quickly
+    int scan_records(const std::string & path)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if(!in)
+        {
+            std::cerr<<"Could not open "<<path<<std::endl;
+            return 1;
+        }
+
+        Record_reader reader(in);
+        Game_record rec;
+        unsigned long long num_games = 0, num_moves = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            while(reader.next(rec))
+            {
+                ++num_games;
+                num_moves += rec.moves.size();
+            }
+        }
+        catch(const std::runtime_error & e)
+        {
+            std::cerr<<"Error in game "<<num_games + 1<<": "<<e.what()<<std::endl;
+            return 1;
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout<<num_games<<" games, "<<num_moves<<" moves in "<<secs<<"s";
+        if(secs > 0.0)
+            std::cout<<" ("<<num_games / secs<<" games/s)";
+        std::cout<<std::endl;
+        return 0;
+    }
+
+    // analyse positions, one per line, from a file or stdin if path is empty or "-"
+    int analyse(const std::string & path, const int threads, const int depth, const int movetime_ms)
+    {
+        std::ifstream file;
+        if(!path.empty() && path != "-")
+        {
+            file.open(path.c_str());
+            if(!file)
+            {
+                std::cerr<<"Could not open "<<path<<std::endl;
+                return 1;
+            }
+        }
+        std::istream & in = (!path.empty() && path != "-")? file: std::cin;
+
+        int num_threads = (threads > 0)? threads: std::max(1u, std::thread::hardware_concurrency());
+        // positions read but not yet written. keeps memory bounded on large inputs
+        const size_t max_in_flight = 16 * num_threads;
+
+        // work queue and finished results, keyed on input order
+        std::mutex mutex;
+        std::condition_variable work_cv, result_cv, space_cv;
+        std::deque<std::pair<size_t, std::string>> work;
+        std::map<size_t, std::string> results;
+        size_t num_read = 0, num_written = 0;
+        bool eof = false;
+        std::atomic<unsigned long long> total_nodes(0);
+
+        auto worker = [&]()
+        {
+            trace.name_thread("analyse worker");
+            while(true)
+            {
+                std::pair<size_t, std::string> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    Trace_span span("queue wait");
+                    work_cv.wait(lock, [&]{ return !work.empty() || eof; });
+                    if(work.empty())
+                        return;
+                    job = std::move(work.front());
+                    work.pop_front();
+                }
+
+                std::ostringstream out;
+                Simple_board b;
+                Player p;
+                std::string error = parse_position(job.second, b, p);
+                if(!error.empty())
+                    out<<"error "<<error;
+                else
+                {
+                    Search_result result = search(b, p, Search_limits(depth, movetime_ms));
+                    total_nodes += result.nodes;
+                    if(result.moves.empty())
+                        out<<"bestmove none";
+                    else
+                        out<<"bestmove "<<result.moves.front()<<" score "<<result.score;
+                    out<<" depth "<<result.depth<<" nodes "<<result.nodes;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[job.first] = out.str();
+                }
+                result_cv.notify_one();
+            }
+        };
+
+        // write results as soon as the next one in order is done
+        auto writer = [&]()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true)
+            {
+                result_cv.wait(lock, [&]{ return results.count(num_written) || (eof && num_written == num_read); });
+                if(!results.count(num_written))
+                    return;
+
+                // write without holding the lock
+                std::string line = std::move(results[num_written]);
+                results.erase(num_written);
+                lock.unlock();
+                std::cout<<line<<'\n';
+                if(results.empty())
+                    std::cout.flush();
+                lock.lock();
+                ++num_written;
+                space_cv.notify_one();
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> workers;
+        for(int i = 0; i < num_threads; ++i)
+            workers.push_back(std::thread(worker));
+        std::thread writer_thread(writer);
+
+        std::string line;
+        while(std::getline(in, line))
+        {
+            // skip blank lines and comments
+            size_t first = line.find_first_not_of(" \t\r");
+            if(first == std::string::npos || line[first] == '#')
+                continue;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space_cv.wait(lock, [&]{ return num_read - num_written < max_in_flight; });
+                work.push_back(std::make_pair(num_read++, line));
+            }
+            work_cv.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            eof = true;
+        }
+        work_cv.notify_all();
+        for(auto & t: workers)
+            t.join();
+        result_cv.notify_all();
+        writer_thread.join();
+        std::cout.flush();
+
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr<<num_read<<" positions in "<<secs<<"s using "<<num_threads<<" threads";
+        if(secs > 0.0)
+            std::cerr<<" ("<<num_read / secs<<" positions/s, "<<total_nodes / secs<<" nodes/s)";
+        std::cerr<<std::endl;
+        return 0;
+    }
+
+    // set on Ctrl-C while solving
+    std::atomic<bool> solve_stop(false);
+
+    void solve_interrupt(int)
+    {
+        solve_stop = true;
+    }
+
+    // solve positions exactly, one per line, from a file or stdin if path is empty or "-"
+    int solve(const std::string & path, const int threads, const int table_mb, const std::string & checkpoint_path,
+        const int checkpoint_secs)
+    {
+        std::ifstream file;
+        if(!path.empty() && path != "-")
+        {
+            file.open(path.c_str());
+            if(!file)
+            {
+                std::cerr<<"Could not open "<<path<<std::endl;
+                return 1;
+            }
+        }
+        std::istream & in = (!path.empty() && path != "-")? file: std::cin;
+
+        Solver solver(std::max(table_mb, 1), threads);
+        solver.checkpoint_path = checkpoint_path;
+        solver.checkpoint_secs = std::max(checkpoint_secs, 1);
+        // resume from the last checkpoint, if there is one
+        if(!checkpoint_path.empty())
+            solver.load(checkpoint_path);
+        std::signal(SIGINT, solve_interrupt);
+
+        std::string line;
+        while(!solve_stop && std::getline(in, line))
+        {
+            // skip blank lines and comments
+            size_t first = line.find_first_not_of(" \t\r");
+            if(first == std::string::npos || line[first] == '#')
+                continue;
+
+            Simple_board b;
+            Player p;
+            std::string error = parse_position(line, b, p);
+            if(!error.empty())
+            {
+                std::cout<<"error "<<error<<std::endl;
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            Solve_result result = solver.solve(b, p, &solve_stop);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if(!result.complete)
+            {
+                std::cout<<"stopped nodes "<<result.nodes<<std::endl;
+                break;
+            }
+            std::cout<<"value "<<result.value<<" bestmove ";
+            if(result.move < 0)
+                std::cout<<"none";
+            else
+                std::cout<<result.move;
+            std::cout<<" nodes "<<result.nodes<<std::endl;
+
+            std::cerr<<"solved in "<<secs<<"s";
+            if(secs > 0.0)
+                std::cerr<<" ("<<result.nodes / secs<<" nodes/s)";
+            std::cerr<<std::endl;
+        }
+
+        std::signal(SIGINT, SIG_DFL);
+        if(!checkpoint_path.empty() && !solver.save(checkpoint_path))
+            std::cerr<<"Could not save checkpoint to "<<checkpoint_path<<std::endl;
+        return solve_stop? 1: 0;
+    }
+
+    // play a game from b to the end with the given search for each player
+    // returns the final score difference for player 1, adding each player's nodes and moves to the totals
+    int play_game(Simple_board b, const Search_limits & p1_limits, const Search_limits & p2_limits,
+        unsigned long long nodes[2], unsigned long long moves[2])
+    {
+        Player p = PLAYER_1;
+        while(!b.finished())
+        {
+            Search_result result = search(b, p, (p == PLAYER_1)? p1_limits: p2_limits);
+            nodes[p] += result.nodes;
+            ++moves[p];
+            if(!b.move(p, result.moves.front()))
+                p = (p == PLAYER_1)? PLAYER_2: PLAYER_1;
+        }
+        int diff = b.store(PLAYER_1) - b.store(PLAYER_2);
+        if(b.collect_rule)
+            diff += b.totals[PLAYER_1] - b.totals[PLAYER_2];
+        return diff;
+    }
+
+    // opening for self-play game g: a few random moves in from the start, so the games differ
+    // returns false if the game ended during the opening
+    bool selfplay_opening(const int g, Simple_board & b)
+    {
+        b = Simple_board();
+        for(int i = 0; i < b.num_bowls; ++i)
+        {
+            b.set_bowl(PLAYER_1, i, 4);
+            b.set_bowl(PLAYER_2, i, 4);
+        }
+        Rng rng(splitmix64(g));
+        Player p = PLAYER_1;
+        // end on player 1's turn, so both players get the same position
+        for(int ply = 0; ply < 4 || p != PLAYER_1; ++ply)
+        {
+            int i;
+            do
+                i = rng.below(b.num_bowls);
+            while(b.bowl(p, i) == 0);
+            if(!b.move(p, i))
+                p = (p == PLAYER_1)? PLAYER_2: PLAYER_1;
+            if(b.finished())
+                return false;
+        }
+        return true;
+    }
+
+    // play the default selective search against a plain full-width search at each look-ahead up to depth
+    // and one deeper
+    int selfplay(const int games, const int depth)
+    {
+        std::cout<<"depth  plain depth  wins draws losses  score  plain nodes/move  selective nodes/move  ratio"
+            <<std::endl;
+        // against plain search at the same look-ahead, and one deeper, which searches about as many nodes
+        for(int row = 0; row < 2 * depth; ++row)
+        {
+            int d = row / 2 + 1;
+            Search_limits selective(d), plain(d + row % 2);
+            plain.max_extensions = 0;
+            plain.reductions = false;
+
+            int wins = 0, draws = 0, losses = 0;
+            // index 0 for selective, 1 for plain
+            unsigned long long nodes[2] = {0, 0}, moves[2] = {0, 0};
+            for(int g = 0; g < games; ++g)
+            {
+                Simple_board start;
+                if(!selfplay_opening(g, start))
+                    continue;
+
+                // once from each side
+                for(int side = 0; side < 2; ++side)
+                {
+                    unsigned long long game_nodes[2] = {0, 0}, game_moves[2] = {0, 0};
+                    int diff = (side == 0)? play_game(start, selective, plain, game_nodes, game_moves):
+                        -play_game(start, plain, selective, game_nodes, game_moves);
+                    nodes[0] += game_nodes[side];
+                    moves[0] += game_moves[side];
+                    nodes[1] += game_nodes[1 - side];
+                    moves[1] += game_moves[1 - side];
+                    if(diff > 0)
+                        ++wins;
+                    else if(diff == 0)
+                        ++draws;
+                    else
+                        ++losses;
+                }
+            }
+
+            int played = wins + draws + losses;
+            double score = played? 100.0 * (wins + 0.5 * draws) / played: 0.0;
+            double selective_nodes = moves[0]? (double)nodes[0] / moves[0]: 0.0;
+            double plain_nodes = moves[1]? (double)nodes[1] / moves[1]: 0.0;
+            std::cout<<std::setw(5)<<d<<std::setw(13)<<plain.depth<<std::setw(6)<<wins<<std::setw(6)<<draws
+                <<std::setw(7)<<losses<<std::setw(6)<<std::fixed<<std::setprecision(0)<<score<<"%"
+                <<std::setw(18)<<plain_nodes<<std::setw(22)<<selective_nodes
+                <<std::setw(7)<<std::setprecision(2)<<(plain_nodes > 0.0? selective_nodes / plain_nodes: 0.0)
+                <<std::endl;
+        }
+        return 0;
+    }
+
+    // run each benchmark for at least this long, in seconds
+    const double BENCH_SECS = 0.5;
+
+    // time the fixed-size search kernels against the generic search, for each size that has one
+    int bench(const int depth)
+    {
+        bool ok = true;
+        std::cout<<"bowls  generic nodes/s  fixed nodes/s  speedup"<<std::endl;
+        for(int num_bowls = FIXED_MIN_BOWLS; num_bowls <= FIXED_MAX_BOWLS; ++num_bowls)
+        {
+            // the start of a game and a few random moves in, the same every run
+            std::vector<std::pair<Simple_board, Player>> samples;
+            Rng rng(splitmix64(num_bowls));
+            for(int plies = 0; plies <= 6; plies += 2)
+            {
+                Simple_board b(num_bowls);
+                for(int i = 0; i < num_bowls; ++i)
+                {
+                    b.set_bowl(PLAYER_1, i, 4);
+                    b.set_bowl(PLAYER_2, i, 4);
+                }
+                Player p = PLAYER_1;
+                for(int ply = 0; ply < plies && !b.finished(); ++ply)
+                {
+                    int i;
+                    do
+                        i = rng.below(num_bowls);
+                    while(b.bowl(p, i) == 0);
+                    if(!b.move(p, i))
+                        p = (p == PLAYER_1)? PLAYER_2: PLAYER_1;
+                }
+                if(!b.finished())
+                    samples.push_back(std::make_pair(b, p));
+            }
+
+            // generic first, then fixed
+            double nodes_per_sec[2];
+            std::vector<Search_result> first_results[2];
+            for(int fixed = 0; fixed < 2; ++fixed)
+            {
+                Search_limits limits(depth);
+                limits.generic = !fixed;
+                double nodes = 0.0, secs = 0.0;
+                auto start = std::chrono::steady_clock::now();
+                do
+                {
+                    for(auto & sample: samples)
+                    {
+                        Search_result result = search(sample.first, sample.second, limits);
+                        nodes += result.nodes;
+                        if(first_results[fixed].size() < samples.size())
+                            first_results[fixed].push_back(result);
+                    }
+                    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+                while(secs < BENCH_SECS);
+                nodes_per_sec[fixed] = nodes / secs;
+            }
+
+            // both should search exactly the same tree
+            bool same = true;
+            for(size_t i = 0; i < samples.size(); ++i)
+            {
+                const Search_result & a = first_results[0][i], & b = first_results[1][i];
+                if(a.moves != b.moves || a.score != b.score || a.nodes != b.nodes)
+                    same = false;
+            }
+
+            std::cout<<std::setw(5)<<num_bowls<<std::setw(17)<<std::fixed<<std::setprecision(0)<<nodes_per_sec[0]
+                <<std::setw(15)<<nodes_per_sec[1]<<std::setw(8)<<std::setprecision(2)
+                <<nodes_per_sec[1] / nodes_per_sec[0]<<"x";
+            if(!same)
+                std::cout<<"  MISMATCH";
+            std::cout<<std::endl;
+            ok = ok && same;
+        }
+        return ok? 0: 1;
+    }
+
+    // largest board and bead count used by fuzz
+    const int FUZZ_MAX_BOWLS = 12;
+    const int FUZZ_MAX_BEADS = 8;
+    // games in each fuzz batch that also play on a full Board, which is much slower than the search boards
+    const int FUZZ_FULL_BOARD_EVERY = 16;
+
+    // position as text, in parse_position's format
+    template<typename Board_type>
+    std::string position_text(const Board_type & b, const Player p)
+    {
+        std::string rules = std::string(b.extra_rule? "e": "") + (b.capture_rule? "c": "") + (b.collect_rule? "l": "");
+        std::ostringstream out;
+        out<<((p == PLAYER_1)? 1: 2)<<" "<<(rules.empty()? "-": rules)<<" "<<b.store(PLAYER_1)<<" "<<b.store(PLAYER_2);
+        for(int i = 0; i < b.num_bowls; ++i)
+            out<<" "<<b.bowl(PLAYER_1, i);
+        for(int i = 0; i < b.num_bowls; ++i)
+            out<<" "<<b.bowl(PLAYER_2, i);
+        return out.str();
+    }
+
+    // do two boards have the same counts and totals
+    template<typename Board_a, typename Board_b>
+    bool same_position(const Board_a & a, const Board_b & b)
+    {
+        for(int i = 0; i < a.num_bowls; ++i)
+            if(a.bowl(PLAYER_1, i) != b.bowl(PLAYER_1, i) || a.bowl(PLAYER_2, i) != b.bowl(PLAYER_2, i))
+                return false;
+        return a.store(PLAYER_1) == b.store(PLAYER_1) && a.store(PLAYER_2) == b.store(PLAYER_2)
+            && a.totals[PLAYER_1] == b.totals[PLAYER_1] && a.totals[PLAYER_2] == b.totals[PLAYER_2];
+    }
+
+    // is a the same position as b with the sides swapped
+    bool swapped_position(const Simple_board & a, const Simple_board & b)
+    {
+        for(int i = 0; i < a.num_bowls; ++i)
+            if(a.bowl(PLAYER_1, i) != b.bowl(PLAYER_2, swap_move(i, b.num_bowls))
+                || a.bowl(PLAYER_2, i) != b.bowl(PLAYER_1, swap_move(i, b.num_bowls)))
+                return false;
+        return a.store(PLAYER_1) == b.store(PLAYER_2) && a.store(PLAYER_2) == b.store(PLAYER_1)
+            && a.totals[PLAYER_1] == b.totals[PLAYER_2] && a.totals[PLAYER_2] == b.totals[PLAYER_1];
+    }
+
+    // do a Board's counts match a Simple_board's
+    bool same_position(const Board & a, const Simple_board & b)
+    {
+        for(int i = 0; i < a.num_bowls; ++i)
+            if((int)a.bottom_row[i].beads.size() != b.bowl(PLAYER_1, i)
+                || (int)a.top_row[i].beads.size() != b.bowl(PLAYER_2, i))
+                return false;
+        return (int)a.r_store.beads.size() == b.store(PLAYER_1) && (int)a.l_store.beads.size() == b.store(PLAYER_2);
+    }
+
+    // play random moves to the end of a game on a Simple_board, a Board_type built from it, and a copy
+    // with the sides swapped, and on a full Board if full is set. everything must agree after each move
+    // returns an empty string, or a description of the first difference
+    template<typename Board_type>
+    std::string fuzz_game(Rng & rng, const Simple_board & start, const int num_beads, const bool full,
+        unsigned long long & moves)
+    {
+        Simple_board b = start;
+        Board_type fast(start);
+        Simple_board swapped = start;
+        swapped.swap_sides();
+        std::unique_ptr<Board> board;
+        if(full)
+        {
+            board.reset(new Board(start.num_bowls, num_beads, 0, start.extra_rule, start.capture_rule,
+                start.collect_rule, rng.next()));
+            if(!same_position(*board, b) || !same_position(Simple_board(*board), b))
+                return "start differs from Board: " + position_text(b, PLAYER_1);
+        }
+
+        Player p = PLAYER_1;
+        std::vector<int> history;
+        while(!b.finished())
+        {
+            int i;
+            do
+                i = rng.below(b.num_bowls);
+            while(b.bowl(p, i) == 0);
+            history.push_back(i);
+
+            // the extra turn check the search uses to order moves
+            int count = b.bowl(p, i);
+            int to_store = (p == PLAYER_1)? b.num_bowls - i: i + 1;
+            bool predicted = b.extra_rule && count % (2 * b.num_bowls + 1) == to_store;
+
+            Player other = (p == PLAYER_1)? PLAYER_2: PLAYER_1;
+            bool extra = b.move(p, i);
+            bool fast_extra = fast.move(p, i);
+            bool swapped_extra = swapped.move(other, swap_move(i, b.num_bowls));
+            ++moves;
+
+            std::string error;
+            if(extra != predicted)
+                error = "extra turn prediction";
+            else if(fast_extra != extra || !same_position(fast, b) || fast.finished() != b.finished())
+                error = "fixed board";
+            else if(swapped_extra != extra || !swapped_position(swapped, b) || swapped.finished() != b.finished())
+                error = "swapped sides";
+            else if(b.totals[PLAYER_1] + b.totals[PLAYER_2] + b.store(PLAYER_1) + b.store(PLAYER_2)
+                != 2 * b.num_bowls * num_beads)
+                error = "bead count";
+            else if(board)
+            {
+                bool board_extra = board->move(p, i);
+                board->changed_bowls.clear();
+                board->sow_log.clear();
+                if(board_extra != extra || !same_position(*board, b) || board->finished() != b.finished())
+                    error = "Board";
+                else if(!same_position(Simple_board(*board), b))
+                    error = "Simple_board copy of Board";
+            }
+            if(!error.empty())
+            {
+                // replay up to the bad move to show where it started
+                Simple_board before = start;
+                Player before_p = PLAYER_1;
+                std::ostringstream out;
+                out<<error<<" differs after move "<<i<<". moves from "<<position_text(start, PLAYER_1)<<":";
+                for(size_t j = 0; j < history.size(); ++j)
+                {
+                    out<<" "<<history[j];
+                    if(j + 1 < history.size() && !before.move(before_p, history[j]))
+                        before_p = (before_p == PLAYER_1)? PLAYER_2: PLAYER_1;
+                }
+                out<<". last position: "<<position_text(before, before_p);
+                return out.str();
+            }
+
+            if(!extra)
+                p = other;
+        }
+        return "";
+    }
+
+    // play games of random moves through every board implementation, checking they agree
+    int fuzz(const int games, const std::uint64_t seed)
+    {
+        std::cout<<"seed "<<seed<<std::endl;
+        Rng rng(seed);
+        unsigned long long moves = 0;
+        auto start_time = std::chrono::steady_clock::now();
+
+        for(int g = 0; g < games; ++g)
+        {
+            int num_bowls = 1 + rng.below(FUZZ_MAX_BOWLS);
+            int num_beads = 1 + rng.below(FUZZ_MAX_BEADS);
+            int rules = rng.below(8);
+            Simple_board b(num_bowls, rules & 1, rules & 2, rules & 4);
+            for(int i = 0; i < num_bowls; ++i)
+            {
+                b.set_bowl(PLAYER_1, i, num_beads);
+                b.set_bowl(PLAYER_2, i, num_beads);
+            }
+
+            bool full = g % FUZZ_FULL_BOARD_EVERY == 0;
+            std::string error;
+            switch(num_bowls)
+            {
+            case 4:
+                error = fuzz_game<Fixed_board<4>>(rng, b, num_beads, full, moves);
+                break;
+            case 5:
+                error = fuzz_game<Fixed_board<5>>(rng, b, num_beads, full, moves);
+                break;
+            case 6:
+                error = fuzz_game<Fixed_board<6>>(rng, b, num_beads, full, moves);
+                break;
+            case 7:
+                error = fuzz_game<Fixed_board<7>>(rng, b, num_beads, full, moves);
+                break;
+            case 8:
+                error = fuzz_game<Fixed_board<8>>(rng, b, num_beads, full, moves);
+                break;
+            default:
+                error = fuzz_game<Simple_board>(rng, b, num_beads, full, moves);
+                break;
+            }
+
+            if(!error.empty())
+            {
+                std::cout<<"game "<<g<<": "<<error<<std::endl;
+                return 1;
+            }
+        }
+
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout<<games<<" games, "<<moves<<" moves, "<<std::fixed<<std::setprecision(0)<<moves / secs
+            <<" moves/s. no differences"<<std::endl;
+        return 0;
+    }
+}
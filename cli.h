@@ -0,0 +1,47 @@
+// cli.h
+// command line (non-GUI) modes
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_CLI_H
+#define MANCALA_CLI_H
+
+#include <string>
+
+#include <cstdint>
+
+namespace Mancala
+{
+    // read every game in a record file, and report how many were read and how quickly
+    // returns the process exit code
+    int scan_records(const std::string & path);
+
+    // analyse positions, one per line, from a file or stdin if path is empty or "-"
+    // results are written to stdout in input order, throughput to stderr
+    // Movetime_ms of 0 searches every position to the full depth
+    // returns the process exit code
+    int analyse(const std::string & path, const int threads, const int depth, const int movetime_ms);
+
+    // solve positions exactly, one per line, from a file or stdin if path is empty or "-"
+    // if checkpoint_path is given, the solver's table is saved there every checkpoint_secs and
+    // reloaded on start, so an interrupted solve can resume. Ctrl-C stops the solve and saves
+    // returns the process exit code
+    int solve(const std::string & path, const int threads, const int table_mb, const std::string & checkpoint_path,
+        const int checkpoint_secs);
+
+    // play the default selective search against a plain full-width search at each look-ahead up to depth,
+    // and plain search one step deeper, reporting results and nodes searched per move
+    // each of games openings is played once from each side
+    // returns the process exit code
+    int selfplay(const int games, const int depth);
+
+    // time the fixed-size search kernels against the generic search, for each size that has one
+    // returns the process exit code. non-zero if any kernel disagrees with the generic search
+    int bench(const int depth);
+
+    // play games of random moves on random board sizes and rules through Board, Simple_board, and the
+    // Fixed_board kernels, checking they agree on counts, extra turns, and the end of the game after every move
+    // seed makes a run repeatable. returns the process exit code. non-zero on the first difference
+    int fuzz(const int games, const std::uint64_t seed);
+}
+
+#endif // MANCALA_CLI_H
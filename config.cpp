@@ -31,3 +31,13 @@ std::string check_in_pwd(const std::string & path)
     else
         return RESOURCE_BASE_DIR + ("/" + path);
 }
+
+std::string find_on_disk(const std::string & path)
+{
+    if(std::ifstream(("./" + path).c_str()))
+        return "./" + path;
+    else if(std::ifstream((RESOURCE_BASE_DIR + ("/" + path)).c_str()))
+        return RESOURCE_BASE_DIR + ("/" + path);
+    else
+        return "";
+}
@@ -2,6 +2,8 @@
 // graphics for mancala
 // Copyright Matthew Chandler 2014
 
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <sstream>
 #include <cmath>
@@ -14,6 +16,7 @@
 
 #include "config.h"
 #include "draw.h"
+#include "trace.h"
 
 // pixel data to be used as fallback image
 const int fallback_h = 16;
@@ -40,18 +43,63 @@ Glib::RefPtr<Gdk::Pixbuf> pixbuf_create_from_file_fallback(const char * filename
     return ret;
 }
 
+// load an image, preferring a copy on disk (for themes) over the one embedded in the executable
+Glib::RefPtr<Gdk::Pixbuf> pixbuf_load(const std::string & filename, const Glib::RefPtr<Gdk::Pixbuf> & fallback)
+{
+    std::string disk_path = find_on_disk(filename);
+    if(!disk_path.empty())
+        return pixbuf_create_from_file_fallback(disk_path.c_str(), fallback);
+
+    Glib::RefPtr<Gdk::Pixbuf> ret;
+    try
+    {
+        ret = Gdk::Pixbuf::create_from_resource(RESOURCE_PREFIX "/" + filename);
+    }
+    catch(const Glib::Error& ex)
+    {
+        std::cerr<<"Resource Error: "<<ex.what()<<std::endl;
+        ret = fallback;
+    }
+    return ret;
+}
+
 namespace Mancala
 {
     Draw::Draw(const int Num_bowls, const int Num_beads, const int Ai_depth,
-            const bool Extra_rule, const bool Capture_rule, const bool Collect_rule):
+            const bool Extra_rule, const bool Capture_rule, const bool Collect_rule, const std::uint64_t Seed):
+        anim_step_ms(60),
+        anim_frames(0),
+        anim_slow_frames(0),
+        anim_max_frame_ms(0.0),
+        show_stats(false),
         hint_player(Mancala::PLAYER_1),
         show_hint(false),
         hint_i(0),
-        b(Num_bowls, Num_beads, Ai_depth, Extra_rule, Capture_rule, Collect_rule)
+        b(Num_bowls, Num_beads, Ai_depth, Extra_rule, Capture_rule, Collect_rule, Seed),
+        bg_cache_w(0),
+        bg_cache_h(0),
+        bg_cache_bowls(0),
+        bead_atlas_w(0),
+        bead_atlas_h(0),
+        num_font("Monospace"),
+        num_font_size(0),
+        anim_tick_id(0),
+        anim_start_time(0),
+        anim_step_time(1.0),
+        anim_t(0.0),
+        anim_num_steps(0),
+        frame_paints(0),
+        frame_layouts(0),
+        queued_hint_player(Mancala::PLAYER_1),
+        queued_show_hint(false),
+        queued_hint_i(0)
     {
         // signal on mouse click
         add_events(Gdk::BUTTON_PRESS_MASK);
 
+        const char * stats_env = std::getenv("MANCALA_RENDER_STATS");
+        show_stats = stats_env && *stats_env && std::string(stats_env) != "0";
+
         // create a fallback image to be used in place of missing files
         // it is a black and magenta checkerboard
         for(int row = 0; row < fallback_h; ++row)
@@ -67,18 +115,32 @@ namespace Mancala
         Glib::RefPtr<Gdk::Pixbuf> fallback_img = Gdk::Pixbuf::create_from_data(fallback_data, Gdk::COLORSPACE_RGB,
             true, 8, fallback_w, fallback_h, fallback_w * 4);
 
-        // load images from disk
-        bg_store = pixbuf_create_from_file_fallback(check_in_pwd("img/bg_store.png").c_str(), fallback_img);
-        bg_bowl = pixbuf_create_from_file_fallback(check_in_pwd("img/bg_bowl.png").c_str(), fallback_img);
-        bg_board = pixbuf_create_from_file_fallback(check_in_pwd("img/bg_board.png").c_str(), fallback_img);
-        hint_img = pixbuf_create_from_file_fallback(check_in_pwd("img/hint.png").c_str(), fallback_img);
-        bead_s_img = pixbuf_create_from_file_fallback(check_in_pwd("img/bead_s.png").c_str(), fallback_img);
-        bead_imgs.push_back(pixbuf_create_from_file_fallback(check_in_pwd("img/bead_red.png").c_str(), fallback_img));
-        bead_imgs.push_back(pixbuf_create_from_file_fallback(check_in_pwd("img/bead_green.png").c_str(), fallback_img));
-        bead_imgs.push_back(pixbuf_create_from_file_fallback(check_in_pwd("img/bead_blue.png").c_str(), fallback_img));
-        bead_imgs.push_back(pixbuf_create_from_file_fallback(check_in_pwd("img/bead_yellow.png").c_str(), fallback_img));
-        bead_imgs.push_back(pixbuf_create_from_file_fallback(check_in_pwd("img/bead_magenta.png").c_str(), fallback_img));
-        bead_imgs.push_back(pixbuf_create_from_file_fallback(check_in_pwd("img/bead_cyan.png").c_str(), fallback_img));
+        // decode images in parallel
+        const std::vector<std::string> img_files =
+        {
+            "img/bg_store.png",
+            "img/bg_bowl.png",
+            "img/bg_board.png",
+            "img/hint.png",
+            "img/bead_s.png",
+            "img/bead_red.png",
+            "img/bead_green.png",
+            "img/bead_blue.png",
+            "img/bead_yellow.png",
+            "img/bead_magenta.png",
+            "img/bead_cyan.png"
+        };
+        std::vector<std::future<Glib::RefPtr<Gdk::Pixbuf>>> img_loads;
+        for(auto & i: img_files)
+            img_loads.push_back(std::async(std::launch::async, pixbuf_load, i, fallback_img));
+
+        bg_store = img_loads[0].get();
+        bg_bowl = img_loads[1].get();
+        bg_board = img_loads[2].get();
+        hint_img = img_loads[3].get();
+        bead_s_img = img_loads[4].get();
+        for(size_t i = 5; i < img_loads.size(); ++i)
+            bead_imgs.push_back(img_loads[i].get());
     }
 
     // helper function to draw an image
@@ -91,136 +153,543 @@ namespace Mancala
         Gdk::Cairo::set_source_pixbuf(cr, img);
         cr->paint();
         cr->restore();
+        ++frame_paints;
     }
 
     // helper function to draw a number
-    void Draw::draw_num(const Cairo::RefPtr<Cairo::Context>& cr, const Pango::FontDescription & font,
-        const int num, const double x, const double y)
+    void Draw::draw_num(const Cairo::RefPtr<Cairo::Context>& cr, const int num, const double x, const double y)
     {
-        std::ostringstream str;
-        int txt_w, txt_h;
-        str<<num;
-        Glib::RefPtr<Pango::Layout> txt = create_pango_layout(str.str());
-        txt->set_font_description(font);
-        txt->get_pixel_size(txt_w, txt_h);
-        cr->move_to(x - .5 * txt_w, y - .5 * txt_h);
-        txt->show_in_cairo_context(cr);
+        cr->set_source_rgb(0.0, 0.0, 0.0);
+
+        auto txt = num_layouts.find(num);
+
+        // lay out numbers we haven't seen at this size yet
+        if(txt == num_layouts.end())
+        {
+            std::ostringstream str;
+            str<<num;
+            Num_layout new_txt;
+            new_txt.layout = create_pango_layout(str.str());
+            new_txt.layout->set_font_description(num_font);
+            new_txt.layout->get_pixel_size(new_txt.w, new_txt.h);
+            txt = num_layouts.insert(std::make_pair(num, new_txt)).first;
+        }
+
+        cr->move_to(x - .5 * txt->second.w, y - .5 * txt->second.h);
+        txt->second.layout->show_in_cairo_context(cr);
+        ++frame_layouts;
     }
 
-    // main drawing routine
-    bool Draw::on_draw(const Cairo::RefPtr<Cairo::Context>& cr)
+    // draw the static background (board, stores, and bowls) into the cache
+    void Draw::update_bg_cache(const Gtk::Allocation & alloc)
     {
         int num_cells = b.num_bowls + 2;
         double inv_num_cells = 1.0 / num_cells;
 
-        Gtk::Allocation alloc = get_allocation();
+        bg_cache = get_window()->create_similar_surface(Cairo::CONTENT_COLOR_ALPHA,
+            alloc.get_width(), alloc.get_height());
+        bg_cache_w = alloc.get_width();
+        bg_cache_h = alloc.get_height();
+        bg_cache_bowls = b.num_bowls;
+        piles.clear();
 
-        Pango::FontDescription font("Monospace");
-        font.set_size(std::min(alloc.get_width(), alloc.get_height()) * .1 * Pango::SCALE);
-        cr->set_source_rgb(0.0, 0.0, 0.0);
+        Cairo::RefPtr<Cairo::Context> cache_cr = Cairo::Context::create(bg_cache);
 
         // draw bg
-        draw_img(cr, bg_board, 0.0, 0.0, alloc.get_width() / (bg_board->get_width() - .5),
+        draw_img(cache_cr, bg_board, 0.0, 0.0, alloc.get_width() / (bg_board->get_width() - .5),
             alloc.get_height() / (bg_board->get_height() - .5));
 
         // draw bg for left store
-        draw_img(cr, bg_store, 0.0, 0.0, alloc.get_width() / (bg_store->get_width() - .5) * inv_num_cells,
+        draw_img(cache_cr, bg_store, 0.0, 0.0, alloc.get_width() / (bg_store->get_width() - .5) * inv_num_cells,
             alloc.get_height() / (bg_store->get_height() - .5));
 
-        // l store beads
-        for(auto & j: b.l_store.beads)
+        // draw bg for right store
+        draw_img(cache_cr, bg_store, alloc.get_width() * (1.0 - inv_num_cells), 0,
+            alloc.get_width() / (bg_store->get_width() - .5) * inv_num_cells,
+            alloc.get_height() / (bg_store->get_height() - .5));
+
+        // bowl bgs
+        for(int i = 0; i < b.num_bowls; ++i)
         {
-            draw_img(cr, bead_imgs[j.color_i], alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                alloc.get_width() / (bead_imgs[j.color_i]->get_width() - .5) * inv_num_cells,
-                alloc.get_height() / (bead_imgs[j.color_i]->get_height() - .5) * .5);
-            draw_img(cr, bead_s_img, alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                alloc.get_width() / (bead_s_img->get_width() - .5) * inv_num_cells,
-                alloc.get_height() / (bead_s_img->get_height() - .5) * .5);
+            draw_img(cache_cr, bg_bowl, alloc.get_width() * (i + 1) * inv_num_cells, 0,
+                alloc.get_width() / (bg_bowl->get_width() - .5) * inv_num_cells,
+                alloc.get_height() / (bg_bowl->get_height() - .5) * .5);
+            draw_img(cache_cr, bg_bowl, alloc.get_width() * (i + 1) * inv_num_cells, .5 * alloc.get_height(),
+                alloc.get_width() / (bg_bowl->get_width() - .5) * inv_num_cells,
+                alloc.get_height() / (bg_bowl->get_height() - .5) * .5);
         }
+    }
 
-        // draw # for left store
-        draw_num(cr, font, b.l_store.beads.size(), alloc.get_width() * .5 * inv_num_cells,
-            alloc.get_height() * .5);
+    // draw each bead color with its shading into the atlas
+    void Draw::update_bead_atlas(const Gtk::Allocation & alloc)
+    {
+        double inv_num_cells = 1.0 / (b.num_bowls + 2);
 
-        // draw bg for right store
-        draw_img(cr, bg_store, alloc.get_width() * (1.0 - inv_num_cells), 0,
-            alloc.get_width() / (bg_store->get_width() - .5) * inv_num_cells,
-            alloc.get_height() / (bg_store->get_height() - .5));
+        // size of the largest scaled bead image
+        double max_w = 0.0, max_h = 0.0;
+        std::vector<Glib::RefPtr<Gdk::Pixbuf>> atlas_imgs = bead_imgs;
+        atlas_imgs.push_back(bead_s_img);
+        for(auto & img: atlas_imgs)
+        {
+            max_w = std::max(max_w, img->get_width() * alloc.get_width() / (img->get_width() - .5) * inv_num_cells);
+            max_h = std::max(max_h, img->get_height() * alloc.get_height() / (img->get_height() - .5) * .5);
+        }
+        bead_atlas_w = (int)std::ceil(max_w);
+        bead_atlas_h = (int)std::ceil(max_h);
+
+        bead_atlas = get_window()->create_similar_surface(Cairo::CONTENT_COLOR_ALPHA,
+            bead_atlas_w * bead_imgs.size(), bead_atlas_h);
 
-        // r store beads
-        for(auto & j: b.r_store.beads)
+        Cairo::RefPtr<Cairo::Context> atlas_cr = Cairo::Context::create(bead_atlas);
+
+        for(size_t i = 0; i < bead_imgs.size(); ++i)
         {
-            draw_img(cr, bead_imgs[j.color_i], alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                alloc.get_width() / (bead_imgs[j.color_i]->get_width() - .5) * inv_num_cells,
-                alloc.get_height() / (bead_imgs[j.color_i]->get_height() - .5) * .5);
-            draw_img(cr, bead_s_img, alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
+            // keep each bead in its own slot
+            atlas_cr->save();
+            atlas_cr->rectangle(bead_atlas_w * i, 0.0, bead_atlas_w, bead_atlas_h);
+            atlas_cr->clip();
+
+            draw_img(atlas_cr, bead_imgs[i], bead_atlas_w * i, 0.0,
+                alloc.get_width() / (bead_imgs[i]->get_width() - .5) * inv_num_cells,
+                alloc.get_height() / (bead_imgs[i]->get_height() - .5) * .5);
+            draw_img(atlas_cr, bead_s_img, bead_atlas_w * i, 0.0,
                 alloc.get_width() / (bead_s_img->get_width() - .5) * inv_num_cells,
                 alloc.get_height() / (bead_s_img->get_height() - .5) * .5);
+
+            atlas_cr->restore();
         }
+    }
 
-        // draw # for right store
-        draw_num(cr, font, b.r_store.beads.size(), alloc.get_width() * (1.0 - .5 * inv_num_cells),
-            alloc.get_height() * .5);
+    // draw a single bead from the atlas
+    void Draw::draw_bead(const Cairo::RefPtr<Cairo::Context>& cr, const Bead & bead, const Gtk::Allocation & alloc)
+    {
+        double x = bead.pos[0];
+        double y = bead.pos[1];
 
-        // draw bowls
-        for(size_t i = 0; i < b.top_row.size(); ++i)
+        // move animated beads from their start pos over the course of their step
+        if(!anim_beads.empty())
         {
-            // draw upper row hint
-            if(hint_player == PLAYER_2 && show_hint && hint_i == (int)i)
+            auto anim = anim_beads.find(&bead);
+            if(anim != anim_beads.end())
             {
-                draw_img(cr, hint_img, alloc.get_width() * (i + 1) * inv_num_cells, 0.0,
-                    alloc.get_width() / (hint_img->get_width() - .5) * inv_num_cells,
-                    alloc.get_height() / (hint_img->get_height() - .5) * .5);
+                double t = std::min(std::max(anim_t - anim->second.step, 0.0), 1.0);
+                t = t * t * (3.0 - 2.0 * t);
+                x = anim->second.from[0] + (x - anim->second.from[0]) * t;
+                y = anim->second.from[1] + (y - anim->second.from[1]) * t;
             }
+        }
 
-            // upper row bgs
-            draw_img(cr, bg_bowl, alloc.get_width() * (i + 1) * inv_num_cells, 0,
-                alloc.get_width() / (bg_bowl->get_width() - .5) * inv_num_cells,
-                alloc.get_height() / (bg_bowl->get_height() - .5) * .5);
+        x *= alloc.get_width();
+        y *= alloc.get_height();
+        cr->set_source(bead_atlas, x - bead_atlas_w * bead.color_i, y);
+        cr->rectangle(x, y, bead_atlas_w, bead_atlas_h);
+        cr->fill();
+        ++frame_paints;
+    }
+
+    // draw all of a bowl's beads, from its cached pile if it has enough of them
+    void Draw::draw_beads(const Cairo::RefPtr<Cairo::Context>& cr, const Bowl & bowl, const Gtk::Allocation & alloc)
+    {
+        // below this many beads, drawing them one by one is cheap enough
+        const size_t pile_min_beads = 24;
+
+        if(bowl.beads.size() < pile_min_beads)
+        {
+            for(auto & i: bowl.beads)
+                draw_bead(cr, i, alloc);
+            return;
+        }
+
+        Pile & pile = piles[&bowl];
+        if(!pile.surface || pile.num_beads != bowl.beads.size() || pile.first_bead != &bowl.beads[0])
+        {
+            pile.rect = bowl_rect(bowl, alloc);
+            pile.num_beads = bowl.beads.size();
+            pile.first_bead = &bowl.beads[0];
+            pile.surface = get_window()->create_similar_surface(Cairo::CONTENT_COLOR_ALPHA,
+                pile.rect.get_width(), pile.rect.get_height());
+
+            Cairo::RefPtr<Cairo::Context> pile_cr = Cairo::Context::create(pile.surface);
+            pile_cr->translate(-pile.rect.get_x(), -pile.rect.get_y());
+            for(auto & i: bowl.beads)
+                if(!anim_beads.count(&i))
+                    draw_bead(pile_cr, i, alloc);
+        }
+
+        cr->set_source(pile.surface, pile.rect.get_x(), pile.rect.get_y());
+        cr->paint();
+        ++frame_paints;
 
-            // upper row beads
-            for(auto & j: b.top_row[i].beads)
+        // moving beads were left out of the pile
+        if(!anim_beads.empty())
+            for(auto & i: bowl.beads)
+                if(anim_beads.count(&i))
+                    draw_bead(cr, i, alloc);
+    }
+
+    // number of frames shown in the stats overlay's graph
+    const size_t stats_history = 120;
+    // frame time at the top of the graph, in ms
+    const double stats_graph_ms = 33.3;
+
+    // area covered by the render stats overlay, in pixels
+    Gdk::Rectangle Draw::stats_rect() const
+    {
+        return Gdk::Rectangle(4, 4, 240, 132);
+    }
+
+    // draw the render stats overlay
+    void Draw::draw_stats(const Cairo::RefPtr<Cairo::Context>& cr, const Gtk::Allocation & alloc)
+    {
+        Gdk::Rectangle rect = stats_rect();
+        cr->save();
+        cr->set_source_rgba(0.0, 0.0, 0.0, 0.7);
+        cr->rectangle(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
+        cr->fill();
+
+        // latest frame, and worst in the graph
+        const Frame_stats & last = frame_history.back();
+        double max_ms = 0.0;
+        for(auto & i: frame_history)
+            max_ms = std::max(max_ms, i.frame_ms);
+
+        std::ostringstream text;
+        text.setf(std::ios::fixed);
+        text.precision(2);
+        text<<last.frame_ms<<" ms (max "<<max_ms<<")\n"
+            <<frame_starts.size()<<" fps\n"
+            <<last.paints<<" paints, "<<last.layouts<<" layouts\n"
+            <<alloc.get_width()<<"x"<<alloc.get_height()<<", "<<b.num_bowls<<" bowls\n"
+            <<"anim "<<anim_frames<<" frames, "<<anim_slow_frames<<" slow (max "<<anim_max_frame_ms<<" ms)";
+
+        if(!stats_layout)
+        {
+            stats_layout = create_pango_layout("");
+            stats_layout->set_font_description(Pango::FontDescription("Monospace 8"));
+        }
+        stats_layout->set_text(text.str());
+        cr->set_source_rgb(1.0, 1.0, 1.0);
+        cr->move_to(rect.get_x() + 8, rect.get_y() + 4);
+        stats_layout->show_in_cairo_context(cr);
+
+        // frame time graph, one bar per frame. bars over 16ms are red
+        double graph_x = rect.get_x() + 8, graph_y = rect.get_y() + rect.get_height() - 4;
+        double graph_h = 40.0;
+        size_t start = stats_history - frame_history.size();
+        for(size_t i = 0; i < frame_history.size(); ++i)
+        {
+            double h = std::min(frame_history[i].frame_ms / stats_graph_ms, 1.0) * graph_h;
+            if(frame_history[i].frame_ms > 16.0)
+                cr->set_source_rgb(1.0, 0.2, 0.2);
+            else
+                cr->set_source_rgb(0.2, 1.0, 0.2);
+            cr->rectangle(graph_x + start + i, graph_y - h, 1.0, h);
+            cr->fill();
+        }
+
+        // 16ms line
+        cr->set_source_rgba(1.0, 1.0, 1.0, 0.5);
+        cr->rectangle(graph_x, graph_y - 16.0 / stats_graph_ms * graph_h, stats_history, 1.0);
+        cr->fill();
+        cr->restore();
+    }
+
+    // area covered by a bowl's bg, beads, and count, in pixels
+    Gdk::Rectangle Draw::bowl_rect(const Bowl & bowl, const Gtk::Allocation & alloc) const
+    {
+        double inv_num_cells = 1.0 / (b.num_bowls + 2);
+
+        // beads are scattered up to 20% of the bowl size from ul, and are a cell wide and half the board high
+        double x1 = std::max(bowl.ul[0] - .2 * bowl.width, 0.0);
+        double y1 = std::max(bowl.ul[1] - .2 * bowl.height, 0.0);
+        double x2 = std::min(bowl.ul[0] + std::max((double)bowl.width, .2 * bowl.width + inv_num_cells), 1.0);
+        double y2 = std::min(bowl.ul[1] + std::max((double)bowl.height, .2 * bowl.height + .5), 1.0);
+
+        // pad for bead images being scaled slightly past the cell size
+        int px1 = (int)std::floor(x1 * alloc.get_width()) - 2;
+        int py1 = (int)std::floor(y1 * alloc.get_height()) - 2;
+        int px2 = (int)std::ceil(x2 * alloc.get_width()) + 2;
+        int py2 = (int)std::ceil(y2 * alloc.get_height()) + 2;
+
+        return Gdk::Rectangle(px1, py1, px2 - px1, py2 - py1);
+    }
+
+    // area covered by the animation: the bowls beads are moving into, and where each bead started from
+    // beads move in a straight line, so this covers their whole path
+    Gdk::Rectangle Draw::anim_rect(const Gtk::Allocation & alloc) const
+    {
+        // join doesn't skip empty rectangles, so start from the first area
+        std::vector<Gdk::Rectangle> areas;
+        for(auto & i: anim_bowls)
+            areas.push_back(bowl_rect(*i, alloc));
+        for(auto & i: anim_beads)
+        {
+            int x = (int)std::floor(i.second.from[0] * alloc.get_width()) - 2;
+            int y = (int)std::floor(i.second.from[1] * alloc.get_height()) - 2;
+            areas.push_back(Gdk::Rectangle(x, y, bead_atlas_w + 4, bead_atlas_h + 4));
+        }
+        if(areas.empty())
+            return Gdk::Rectangle(0, 0, 0, 0);
+        Gdk::Rectangle rect = areas.front();
+        for(auto & i: areas)
+            rect.join(i);
+        return rect;
+    }
+
+    // queue redraws for bowls in b.changed_bowls and for hint changes
+    void Draw::queue_draw_changed()
+    {
+        Gtk::Allocation alloc = get_allocation();
+
+        for(auto & i: b.changed_bowls)
+        {
+            Gdk::Rectangle rect = bowl_rect(*i, alloc);
+            queue_draw_area(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
+            piles.erase(i);
+        }
+        b.changed_bowls.clear();
+
+        if(show_hint != queued_show_hint || hint_player != queued_hint_player || hint_i != queued_hint_i)
+        {
+            // redraw the old and new hint locations
+            if(queued_show_hint && queued_hint_i < b.num_bowls)
             {
-                draw_img(cr, bead_imgs[j.color_i], alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                    alloc.get_width() / (bead_imgs[j.color_i]->get_width() - .5) * inv_num_cells,
-                    alloc.get_height() / (bead_imgs[j.color_i]->get_height() - .5) * .5);
-                draw_img(cr, bead_s_img, alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                    alloc.get_width() / (bead_s_img->get_width() - .5) * inv_num_cells,
-                    alloc.get_height() / (bead_s_img->get_height() - .5) * .5);
+                const Bowl & old_hint = (queued_hint_player == PLAYER_1)?
+                    b.bottom_row[queued_hint_i]: b.top_row[queued_hint_i];
+                Gdk::Rectangle rect = bowl_rect(old_hint, alloc);
+                queue_draw_area(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
+            }
+            if(show_hint && hint_i < b.num_bowls)
+            {
+                const Bowl & new_hint = (hint_player == PLAYER_1)? b.bottom_row[hint_i]: b.top_row[hint_i];
+                Gdk::Rectangle rect = bowl_rect(new_hint, alloc);
+                queue_draw_area(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
             }
 
-            // upper row txt
-            draw_num(cr, font, b.top_row[i].beads.size(), alloc.get_width() * (2 * i + 3) * .5 * inv_num_cells,
-                alloc.get_height() * .25);
+            queued_show_hint = show_hint;
+            queued_hint_player = hint_player;
+            queued_hint_i = hint_i;
+        }
+
+        if(anim_step_ms > 0 && !b.sow_log.empty())
+            start_animation();
+        b.sow_log.clear();
+    }
 
-            // draw lower row hint
-            if(hint_player == PLAYER_1 && show_hint && hint_i == (int)i)
+    // stop any running animation, leaving beads where they landed
+    void Draw::stop_animation()
+    {
+        if(anim_tick_id != 0)
+            remove_tick_callback(anim_tick_id);
+        anim_tick_id = 0;
+        anim_beads.clear();
+        anim_bowls.clear();
+        // the board may be about to be replaced
+        piles.clear();
+        queue_draw();
+    }
+
+    // start animating the beads in b.sow_log
+    void Draw::start_animation()
+    {
+        // the whole animation is limited to this long, regardless of the number of steps
+        const double max_anim_ms = 1500.0;
+
+        // any animation in progress is dropped, and its beads snap into place
+        for(auto & i: anim_bowls)
+            piles.erase(i);
+        anim_beads.clear();
+        anim_bowls.clear();
+        anim_num_steps = 0;
+        for(auto & i: b.sow_log)
+        {
+            // skip beads that were later captured or collected by the same move
+            if(i.bead_i < i.bowl->beads.size())
             {
-                draw_img(cr, hint_img, alloc.get_width() * (i + 1) * inv_num_cells, .5 * alloc.get_height(),
-                    alloc.get_width() / (hint_img->get_width() - .5) * inv_num_cells,
-                    alloc.get_height() / (hint_img->get_height() - .5) * .5);
+                anim_beads[&i.bowl->beads[i.bead_i]] = {i.from, i.step};
+                // redraw piles without their moving beads
+                anim_bowls.push_back(i.bowl);
+                piles.erase(i.bowl);
             }
+            anim_num_steps = std::max(anim_num_steps, i.step + 1);
+        }
+
+        anim_step_time = std::min((double)anim_step_ms, max_anim_ms / anim_num_steps) * 1000.0;
+        anim_start_time = 0;
+        anim_t = 0.0;
+
+        anim_frames = anim_slow_frames = 0;
+        anim_max_frame_ms = 0.0;
+
+        if(anim_tick_id == 0)
+            anim_tick_id = add_tick_callback(sigc::mem_fun(*this, &Draw::anim_tick));
+        Gdk::Rectangle rect = anim_rect(get_allocation());
+        queue_draw_area(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
+    }
 
-            // lower row bgs
-            draw_img(cr, bg_bowl, alloc.get_width() * (i + 1) * inv_num_cells, .5 * alloc.get_height(),
+    // frame clock callback to advance the animation
+    // positions are based on the frame time, so slow frames are skipped rather than slowing the animation
+    bool Draw::anim_tick(const Glib::RefPtr<Gdk::FrameClock> & clock)
+    {
+        gint64 now = clock->get_frame_time();
+        if(anim_start_time == 0)
+            anim_start_time = now;
+
+        anim_t = (now - anim_start_time) / anim_step_time;
+        Gdk::Rectangle rect = anim_rect(get_allocation());
+        queue_draw_area(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
+
+        if(anim_t >= anim_num_steps)
+        {
+            // put the beads that were moving back into their piles
+            for(auto & i: anim_bowls)
+                piles.erase(i);
+            anim_beads.clear();
+            anim_bowls.clear();
+            anim_tick_id = 0;
+            return false;
+        }
+        return true;
+    }
+
+    // main drawing routine
+    bool Draw::on_draw(const Cairo::RefPtr<Cairo::Context>& cr)
+    {
+        Trace_span span("on_draw");
+        auto frame_start = std::chrono::steady_clock::now();
+        frame_paints = frame_layouts = 0;
+
+        int num_cells = b.num_bowls + 2;
+        double inv_num_cells = 1.0 / num_cells;
+
+        Gtk::Allocation alloc = get_allocation();
+        if(alloc.get_width() <= 0 || alloc.get_height() <= 0)
+            return true;
+
+        // font size follows the window size. drop cached counts when it changes
+        int font_size = std::min(alloc.get_width(), alloc.get_height()) * .1 * Pango::SCALE;
+        if(font_size != num_font_size)
+        {
+            num_font_size = font_size;
+            num_font.set_size(num_font_size);
+            num_layouts.clear();
+        }
+
+        // draw bg, rebuilding the cached copy if the layout changed
+        if(!bg_cache || bg_cache_w != alloc.get_width() || bg_cache_h != alloc.get_height()
+            || bg_cache_bowls != b.num_bowls)
+        {
+            update_bg_cache(alloc);
+            update_bead_atlas(alloc);
+        }
+
+        cr->set_source(bg_cache, 0.0, 0.0);
+        cr->paint();
+        ++frame_paints;
+
+        // skip bowls outside of the area being redrawn
+        double clip_x1, clip_y1, clip_x2, clip_y2;
+        cr->get_clip_extents(clip_x1, clip_y1, clip_x2, clip_y2);
+        auto visible = [&](const Bowl & bowl)
+        {
+            Gdk::Rectangle rect = bowl_rect(bowl, alloc);
+            return rect.get_x() < clip_x2 && rect.get_x() + rect.get_width() > clip_x1
+                && rect.get_y() < clip_y2 && rect.get_y() + rect.get_height() > clip_y1;
+        };
+
+        // the hint goes between the board and the bowl bg. the cached bg already has the bowl,
+        // so redraw the hinted cell from the board up
+        if(show_hint && hint_i >= 0 && hint_i < b.num_bowls)
+        {
+            double hint_x = alloc.get_width() * (hint_i + 1) * inv_num_cells;
+            double hint_y = (hint_player == PLAYER_2)? 0.0 : .5 * alloc.get_height();
+            cr->save();
+            cr->rectangle(hint_x, hint_y, alloc.get_width() * inv_num_cells, .5 * alloc.get_height());
+            cr->clip();
+            draw_img(cr, bg_board, 0.0, 0.0, alloc.get_width() / (bg_board->get_width() - .5),
+                alloc.get_height() / (bg_board->get_height() - .5));
+            draw_img(cr, hint_img, hint_x, hint_y,
+                alloc.get_width() / (hint_img->get_width() - .5) * inv_num_cells,
+                alloc.get_height() / (hint_img->get_height() - .5) * .5);
+            draw_img(cr, bg_bowl, hint_x, hint_y,
                 alloc.get_width() / (bg_bowl->get_width() - .5) * inv_num_cells,
                 alloc.get_height() / (bg_bowl->get_height() - .5) * .5);
+            cr->restore();
+        }
+
+        // left store beads and #
+        if(visible(b.l_store))
+        {
+            draw_beads(cr, b.l_store, alloc);
+            draw_num(cr, b.l_store.beads.size(), alloc.get_width() * .5 * inv_num_cells,
+                alloc.get_height() * .5);
+        }
+
+        // right store beads and #
+        if(visible(b.r_store))
+        {
+            draw_beads(cr, b.r_store, alloc);
+            draw_num(cr, b.r_store.beads.size(), alloc.get_width() * (1.0 - .5 * inv_num_cells),
+                alloc.get_height() * .5);
+        }
 
-            // lower row beads
-            for(auto & j: b.bottom_row[i].beads)
+        // draw bowls
+        for(size_t i = 0; i < b.top_row.size(); ++i)
+        {
+            // upper row beads and #
+            if(visible(b.top_row[i]))
             {
-                draw_img(cr, bead_imgs[j.color_i], alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                    alloc.get_width() / (bead_imgs[j.color_i]->get_width() - .5) * inv_num_cells,
-                    alloc.get_height() / (bead_imgs[j.color_i]->get_height() - .5) * .5);
-                draw_img(cr, bead_s_img, alloc.get_width() * j.pos[0], alloc.get_height() * j.pos[1],
-                    alloc.get_width() / (bead_s_img->get_width() - .5) * inv_num_cells,
-                    alloc.get_height() / (bead_s_img->get_height() - .5) * .5);
+                draw_beads(cr, b.top_row[i], alloc);
+                draw_num(cr, b.top_row[i].beads.size(),
+                    alloc.get_width() * (2 * i + 3) * .5 * inv_num_cells, alloc.get_height() * .25);
             }
 
-            // lower row txt
-            draw_num(cr, font, b.bottom_row[i].beads.size(), alloc.get_width() * (2 * i + 3) * .5 * inv_num_cells,
-                alloc.get_height() * .75);
+            // lower row beads and #
+            if(visible(b.bottom_row[i]))
+            {
+                draw_beads(cr, b.bottom_row[i], alloc);
+                draw_num(cr, b.bottom_row[i].beads.size(),
+                    alloc.get_width() * (2 * i + 3) * .5 * inv_num_cells, alloc.get_height() * .75);
+            }
         }
+
+        double frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+            - frame_start).count();
+
+        // track frame time while animating
+        if(!anim_beads.empty())
+        {
+            ++anim_frames;
+            if(frame_ms > 16.0)
+                ++anim_slow_frames;
+            anim_max_frame_ms = std::max(anim_max_frame_ms, frame_ms);
+        }
+
+        if(show_stats)
+        {
+            // frames that only redraw the overlay itself aren't counted
+            Gdk::Rectangle rect = stats_rect();
+            bool overlay_only = clip_x1 >= rect.get_x() && clip_y1 >= rect.get_y()
+                && clip_x2 <= rect.get_x() + rect.get_width() && clip_y2 <= rect.get_y() + rect.get_height();
+            if(!overlay_only || frame_history.empty())
+            {
+                frame_history.push_back({frame_ms, frame_paints, frame_layouts});
+                if(frame_history.size() > stats_history)
+                    frame_history.pop_front();
+                frame_starts.push_back(frame_start);
+            }
+            while(!frame_starts.empty() && frame_start - frame_starts.front() > std::chrono::seconds(1))
+                frame_starts.pop_front();
+
+            draw_stats(cr, alloc);
+
+            // a redraw that missed the overlay leaves it out of date
+            bool overlay_drawn = clip_x1 <= rect.get_x() && clip_y1 <= rect.get_y()
+                && clip_x2 >= rect.get_x() + rect.get_width() && clip_y2 >= rect.get_y() + rect.get_height();
+            if(!overlay_drawn)
+                queue_draw_area(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
+        }
+
         return true;
     }
 }
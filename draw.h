@@ -5,6 +5,11 @@
 #ifndef MANCALA_DRAW_H
 #define MANCALA_DRAW_H
 
+#include <chrono>
+#include <deque>
+#include <map>
+#include <unordered_map>
+
 #include <gtkmm/drawingarea.h>
 
 #include "board.h"
@@ -15,11 +20,29 @@ namespace Mancala
     {
     public:
         Draw(const int Num_bowls = 6, const int Num_beads = 4, const int Ai_depth = 10,
-            const bool Extra_rule = true, const bool Capture_rule = true, const bool Collect_rule = true);
+            const bool Extra_rule = true, const bool Capture_rule = true, const bool Collect_rule = true,
+            const std::uint64_t Seed = 0);
 
         // main drawing routine
         bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr);
 
+        // queue redraws for bowls in b.changed_bowls and for hint changes,
+        // and animate beads in b.sow_log. clears both
+        void queue_draw_changed();
+        // stop any running animation, leaving beads where they landed
+        void stop_animation();
+
+        // time for each sowing step, in ms. 0 disables animation
+        int anim_step_ms;
+
+        // frame timing for the current / most recent animation
+        int anim_frames, anim_slow_frames;
+        double anim_max_frame_ms;
+
+        // show frame time, frame rate, and paint / text layout counts over the board
+        // turned on at startup by setting MANCALA_RENDER_STATS
+        bool show_stats;
+
         // state vars
         Player hint_player;
         bool show_hint;
@@ -33,8 +56,27 @@ namespace Mancala
         void draw_img(const Cairo::RefPtr<Cairo::Context>& cr, const Glib::RefPtr<Gdk::Pixbuf>&  img,
             const double translate_x, const double translate_y, const double scale_x, const double scale_y);
         // helper function to draw a number
-        void draw_num(const Cairo::RefPtr<Cairo::Context>& cr, const Pango::FontDescription & font, const int num,
-            const double x, const double y);
+        void draw_num(const Cairo::RefPtr<Cairo::Context>& cr, const int num, const double x, const double y);
+        // draw the static background (board, stores, and bowls) into the cache
+        void update_bg_cache(const Gtk::Allocation & alloc);
+        // draw each bead color with its shading into the atlas
+        void update_bead_atlas(const Gtk::Allocation & alloc);
+        // draw a single bead from the atlas
+        void draw_bead(const Cairo::RefPtr<Cairo::Context>& cr, const Bead & bead, const Gtk::Allocation & alloc);
+        // draw all of a bowl's beads, from its cached pile if it has enough of them
+        void draw_beads(const Cairo::RefPtr<Cairo::Context>& cr, const Bowl & bowl, const Gtk::Allocation & alloc);
+        // draw the render stats overlay
+        void draw_stats(const Cairo::RefPtr<Cairo::Context>& cr, const Gtk::Allocation & alloc);
+        // area covered by the render stats overlay, in pixels
+        Gdk::Rectangle stats_rect() const;
+        // area covered by a bowl's bg, beads, and count, in pixels
+        Gdk::Rectangle bowl_rect(const Bowl & bowl, const Gtk::Allocation & alloc) const;
+        // area covered by the animation in progress, in pixels
+        Gdk::Rectangle anim_rect(const Gtk::Allocation & alloc) const;
+        // start animating the beads in b.sow_log
+        void start_animation();
+        // frame clock callback to advance the animation
+        bool anim_tick(const Glib::RefPtr<Gdk::FrameClock> & clock);
 
         // Images
         Glib::RefPtr<Gdk::Pixbuf> bg_store;
@@ -43,6 +85,75 @@ namespace Mancala
         Glib::RefPtr<Gdk::Pixbuf> hint_img;
         Glib::RefPtr<Gdk::Pixbuf> bead_s_img;
         std::vector<Glib::RefPtr<Gdk::Pixbuf>> bead_imgs;
+
+        // pre-scaled background, rebuilt on resize or board size change
+        Cairo::RefPtr<Cairo::Surface> bg_cache;
+        int bg_cache_w, bg_cache_h, bg_cache_bowls;
+
+        // shaded beads of each color, pre-scaled and side-by-side. rebuilt with bg_cache
+        Cairo::RefPtr<Cairo::Surface> bead_atlas;
+        int bead_atlas_w, bead_atlas_h; // size of one bead in the atlas
+
+        // pre-drawn beads for bowls with many of them, so a frame costs the same however many beads there are
+        // animated beads are left out and drawn on top
+        struct Pile
+        {
+            Cairo::RefPtr<Cairo::Surface> surface;
+            Gdk::Rectangle rect;
+            // the beads the pile was drawn from, to catch changes that weren't queued
+            size_t num_beads;
+            const Bead * first_bead;
+        };
+        // cleared on resize, and for each bowl when it changes or its beads start / stop moving
+        std::unordered_map<const Bowl *, Pile> piles;
+
+        // laid-out text for bowl / store counts
+        struct Num_layout
+        {
+            Glib::RefPtr<Pango::Layout> layout;
+            int w, h;
+        };
+        // cached count layouts, keyed on value. cleared when the font size changes
+        std::map<int, Num_layout> num_layouts;
+        Pango::FontDescription num_font;
+        int num_font_size;
+
+        // beads in motion, and where / when they start moving
+        struct Anim_bead
+        {
+            std::vector<double> from;
+            int step;
+        };
+        std::unordered_map<const Bead *, Anim_bead> anim_beads;
+        // bowls that beads are moving into
+        std::vector<const Bowl *> anim_bowls;
+        guint anim_tick_id;
+        // frame time of the first animation frame, in us. 0 until the first tick
+        gint64 anim_start_time;
+        // length of each step, in us
+        double anim_step_time;
+        // progress through the animation, in steps
+        double anim_t;
+        int anim_num_steps;
+
+        // render stats for one frame
+        struct Frame_stats
+        {
+            double frame_ms;
+            int paints, layouts;
+        };
+        // counts for the frame being drawn
+        int frame_paints, frame_layouts;
+        // most recent frames, oldest first
+        std::deque<Frame_stats> frame_history;
+        // when each frame in the last second started, for the frame rate
+        std::deque<std::chrono::steady_clock::time_point> frame_starts;
+        Glib::RefPtr<Pango::Layout> stats_layout;
+
+        // hint state as of the last queue_draw_changed
+        Player queued_hint_player;
+        bool queued_show_hint;
+        int queued_hint_i;
     };
 }
 #endif // MANCALA_DRAW_H
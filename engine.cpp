@@ -0,0 +1,433 @@
+// engine.cpp
+// long-running AI engine, driven by a line-based text protocol
+// Copyright Matthew Chandler 2014
+
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "engine.h"
+#include "trace.h"
+
+namespace Mancala
+{
+    // transposition table size for solve, in MB
+    const size_t ENGINE_SOLVER_MB = 64;
+
+    Engine::Engine():
+        default_depth(10),
+        out(&std::cout),
+        board(6),
+        player(PLAYER_1),
+        searching(false),
+        pondering(false),
+        solving(false),
+        quitting(false),
+        stop(false)
+    {
+        // start with a new game
+        for(int i = 0; i < board.num_bowls; ++i)
+        {
+            board.set_bowl(PLAYER_1, i, 4);
+            board.set_bowl(PLAYER_2, i, 4);
+        }
+
+        // the search thread is kept for the life of the engine, so searches start immediately
+        search_thread = std::thread(&Engine::search_thread_func, this);
+    }
+
+    Engine::~Engine()
+    {
+        stop_search();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quitting = true;
+        }
+        cv.notify_all();
+        search_thread.join();
+    }
+
+    // run commands from in until quit or end of input, writing responses to out
+    void Engine::session(std::istream & in, std::ostream & out)
+    {
+        {
+            std::lock_guard<std::mutex> lock(out_mutex);
+            this->out = &out;
+        }
+
+        std::string line;
+        while(std::getline(in, line))
+        {
+            if(!command(line))
+                break;
+        }
+
+        // finish before the output goes away. searches with a limit are allowed to complete
+        if(pondering)
+            stop_search();
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]{ return !searching; });
+        }
+    }
+
+    // handle a command. returns false on quit
+    bool Engine::command(const std::string & line)
+    {
+        std::istringstream cmd(line);
+        std::string name;
+        if(!(cmd>>name))
+            return true;
+
+        if(name == "quit")
+            return false;
+
+        else if(name == "isready")
+        {
+            send("readyok");
+        }
+        else if(name == "stop")
+        {
+            stop_search();
+        }
+        else if(name == "position")
+        {
+            stop_search();
+            std::string rest;
+            std::getline(cmd, rest);
+            std::istringstream args(rest);
+            std::string first;
+            args>>first;
+            if(first == "start")
+            {
+                int num_bowls = 6, num_beads = 4;
+                args>>num_bowls>>num_beads;
+                if(num_bowls < 1 || num_beads < 0)
+                {
+                    send("error invalid board size");
+                    return true;
+                }
+                board = Simple_board(num_bowls, board.extra_rule, board.capture_rule, board.collect_rule);
+                for(int i = 0; i < num_bowls; ++i)
+                {
+                    board.set_bowl(PLAYER_1, i, num_beads);
+                    board.set_bowl(PLAYER_2, i, num_beads);
+                }
+                player = PLAYER_1;
+            }
+            else
+            {
+                Simple_board new_board;
+                Player new_player;
+                std::string error = parse_position(rest, new_board, new_player);
+                if(!error.empty())
+                {
+                    send("error " + error);
+                    return true;
+                }
+                board = new_board;
+                player = new_player;
+            }
+        }
+        else if(name == "rules")
+        {
+            stop_search();
+            std::string rules;
+            cmd>>rules;
+            if(!parse_rules(rules, board.extra_rule, board.capture_rule, board.collect_rule))
+                send("error unknown rule in '" + rules + "'");
+        }
+        else if(name == "move")
+        {
+            stop_search();
+            int i = -1;
+            cmd>>i;
+            if(i < 0 || i >= board.num_bowls || board.bowl(player, i) == 0 || board.finished())
+            {
+                send("error illegal move");
+                return true;
+            }
+            if(!board.move(player, i))
+                player = (player == PLAYER_1)? PLAYER_2: PLAYER_1;
+        }
+        else if(name == "go" || name == "ponder")
+        {
+            stop_search();
+            // ponder runs until stopped unless given a depth
+            Search_limits new_limits((name == "go")? default_depth: 1000);
+            std::string arg;
+            while(cmd>>arg)
+            {
+                if(arg == "depth")
+                    cmd>>new_limits.depth;
+                else if(arg == "movetime" && name == "go")
+                    cmd>>new_limits.movetime_ms;
+                else
+                {
+                    send("error unknown argument '" + arg + "'");
+                    return true;
+                }
+            }
+            if(new_limits.depth < 0 || new_limits.movetime_ms < 0)
+            {
+                send("error invalid limit");
+                return true;
+            }
+            pondering = name == "ponder";
+            solving = false;
+            start_search(new_limits);
+        }
+        else if(name == "solve")
+        {
+            stop_search();
+            if(board.num_bowls > SOLVER_MAX_BOWLS)
+            {
+                send("error board too large to solve");
+                return true;
+            }
+            pondering = false;
+            solving = true;
+            start_search(Search_limits(default_depth));
+        }
+        else
+            send("error unknown command '" + name + "'");
+
+        return true;
+    }
+
+    // write a line of output
+    void Engine::send(const std::string & line)
+    {
+        std::lock_guard<std::mutex> lock(out_mutex);
+        *out<<line<<std::endl;
+    }
+
+    // stop any search in progress, and wait for its bestmove
+    void Engine::stop_search()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+        cv.wait(lock, [this]{ return !searching; });
+        stop = false;
+    }
+
+    // start a search in the background
+    void Engine::start_search(const Search_limits & new_limits)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            limits = new_limits;
+            limits.stop = &stop;
+            searching = true;
+        }
+        cv.notify_all();
+    }
+
+    // runs searches as they're requested
+    void Engine::search_thread_func()
+    {
+        trace.name_thread("engine search");
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            {
+                Trace_span span("queue wait");
+                cv.wait(lock, [this]{ return searching || quitting; });
+            }
+            if(quitting)
+                return;
+
+            // the position isn't changed while searching, so it's safe to read unlocked
+            Search_limits search_limits = limits;
+            lock.unlock();
+
+            if(solving)
+            {
+                if(!solver)
+                    solver.reset(new Solver(ENGINE_SOLVER_MB));
+                Solve_result solved = solver->solve(board, player, &stop);
+                // when stopped, report the best move proven so far, if any
+                if(solved.complete || solved.move >= 0)
+                {
+                    if(solved.complete)
+                    {
+                        std::ostringstream info;
+                        info<<"info solved value "<<solved.value<<" nodes "<<solved.nodes;
+                        send(info.str());
+                    }
+                    send((solved.move < 0)? "bestmove none": "bestmove " + std::to_string(solved.move));
+
+                    lock.lock();
+                    searching = false;
+                    cv.notify_all();
+                    continue;
+                }
+                // stopped before any move was proven. fall back to a normal search so there's still a move.
+                // it's stopped too, so only its first look-ahead, which can't be aborted, is completed
+            }
+
+            search_limits.on_depth = [this](const Search_result & result)
+            {
+                std::ostringstream info;
+                info<<"info depth "<<result.depth<<" score "<<result.score<<" nodes "<<result.nodes;
+                send(info.str());
+            };
+            Search_result result = search(board, player, search_limits);
+
+            if(result.moves.empty())
+                send("bestmove none");
+            else
+                send("bestmove " + std::to_string(result.moves.front()));
+
+            lock.lock();
+            searching = false;
+            cv.notify_all();
+        }
+    }
+
+    // run an engine session on stdin / stdout
+    int run_engine(const int depth)
+    {
+        Engine engine;
+        engine.default_depth = depth;
+        engine.session(std::cin, std::cout);
+        return 0;
+    }
+
+#ifndef _WIN32
+    // a client that disconnects shouldn't kill the engine with SIGPIPE. Linux can turn it off per send,
+    // macOS and the BSDs per socket (see run_engine_socket)
+#ifdef MSG_NOSIGNAL
+    const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    const int SEND_FLAGS = 0;
+#endif
+
+    // stream buffer over a socket
+    class Fd_streambuf: public std::streambuf
+    {
+    public:
+        Fd_streambuf(const int Fd): fd(Fd)
+        {
+            setg(in_buf, in_buf, in_buf);
+            setp(out_buf, out_buf + sizeof(out_buf));
+        }
+        ~Fd_streambuf()
+        {
+            sync();
+        }
+
+    protected:
+        int underflow()
+        {
+            ssize_t n = read(fd, in_buf, sizeof(in_buf));
+            if(n <= 0)
+                return traits_type::eof();
+            setg(in_buf, in_buf, in_buf + n);
+            return traits_type::to_int_type(in_buf[0]);
+        }
+        int overflow(int c)
+        {
+            if(sync() == -1)
+                return traits_type::eof();
+            if(c != traits_type::eof())
+            {
+                *pptr() = c;
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+        int sync()
+        {
+            for(char * p = pbase(); p < pptr();)
+            {
+                ssize_t n = ::send(fd, p, pptr() - p, SEND_FLAGS);
+                if(n <= 0)
+                    return -1;
+                p += n;
+            }
+            setp(out_buf, out_buf + sizeof(out_buf));
+            return 0;
+        }
+
+    private:
+        int fd;
+        char in_buf[4096];
+        char out_buf[4096];
+    };
+
+    // run engine sessions for each client of a Unix domain socket, one at a time
+    int run_engine_socket(const std::string & path, const int depth)
+    {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(path.size() >= sizeof(addr.sun_path))
+        {
+            std::cerr<<"Socket path too long: "<<path<<std::endl;
+            return 1;
+        }
+        std::strcpy(addr.sun_path, path.c_str());
+
+        // remove a stale socket from a previous run, but never anything else
+        struct stat st;
+        if(stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(path.c_str());
+
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listen_fd < 0 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 4) < 0)
+        {
+            std::perror(("Could not listen on " + path).c_str());
+            if(listen_fd >= 0)
+                close(listen_fd);
+            return 1;
+        }
+
+        Engine engine;
+        engine.default_depth = depth;
+#if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+        // no way to turn SIGPIPE off for just the socket
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+        while(true)
+        {
+            int fd = accept(listen_fd, NULL, NULL);
+            if(fd < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                std::perror("accept");
+                break;
+            }
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+            {
+                Fd_streambuf buf(fd);
+                std::iostream stream(&buf);
+                engine.session(stream, stream);
+            }
+            close(fd);
+        }
+
+        close(listen_fd);
+        unlink(path.c_str());
+        return 1;
+    }
+#endif
+}
@@ -0,0 +1,102 @@
+// engine.h
+// long-running AI engine, driven by a line-based text protocol
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_ENGINE_H
+#define MANCALA_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "search.h"
+#include "solver.h"
+
+// Protocol. One command per line, responses are one or more lines:
+//   position start [bowls] [beads]  set up a new game (default 6 bowls, 4 beads), keeping the rules
+//   position <side> <rules> <p1 store> <p2 store> <p1 bowls...> <p2 bowls...>
+//                                   set the position, in the same format as --analyse
+//   rules <rules>                   change the rules. any of e, c, l, or - for none
+//   move <bowl>                     make a move for the side to move
+//   go [depth N] [movetime MS]      search the position. prints info lines as each depth completes, then
+//                                   bestmove <bowl> (or bestmove none if there are no moves)
+//   ponder [depth N]                search until stop, or until N is reached
+//   solve                           search to the end of the game. prints info solved value <v> nodes <n>,
+//                                   then bestmove. only practical for small boards: from the start of a
+//                                   6 bowl game, it runs for a very long time. can be stopped, in which case
+//                                   the bestmove is the best move proven so far, or from a quick search if
+//                                   no move has been searched to the end yet
+//   stop                            end the current search early. its bestmove is still printed
+//   isready                         prints readyok once any previous command has been handled
+//   quit                            end the session
+// a new position, rules, move or search stops any search in progress
+// errors are reported as: error <message>
+
+namespace Mancala
+{
+    class Engine
+    {
+    public:
+        Engine();
+        ~Engine();
+
+        // run commands from in until quit or end of input, writing responses to out
+        // the engine (and its search thread) can be reused for more sessions
+        void session(std::istream & in, std::ostream & out);
+
+        // default look-ahead for go
+        int default_depth;
+
+    private:
+        // handle a command. returns false on quit
+        bool command(const std::string & line);
+        // write a line of output
+        void send(const std::string & line);
+        // stop any search in progress, and wait for its bestmove
+        void stop_search();
+        // start a search in the background
+        void start_search(const Search_limits & limits);
+        // runs searches as they're requested
+        void search_thread_func();
+
+        std::ostream * out;
+        std::mutex out_mutex;
+
+        // current position
+        Simple_board board;
+        Player player;
+
+        // search thread state
+        std::thread search_thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        // a search has been requested, but not finished
+        bool searching;
+        // the current search was started by ponder, so is stopped rather than waited on
+        bool pondering;
+        // the current search was started by solve
+        bool solving;
+        bool quitting;
+        Search_limits limits;
+        std::atomic<bool> stop;
+        // created on the first solve, and kept so later solves reuse its table
+        std::unique_ptr<Solver> solver;
+    };
+
+    // run an engine session on stdin / stdout
+    // returns the process exit code
+    int run_engine(const int depth);
+
+#ifndef _WIN32
+    // run engine sessions for each client of a Unix domain socket, one at a time
+    // returns the process exit code
+    int run_engine_socket(const std::string & path, const int depth);
+#endif
+}
+
+#endif // MANCALA_ENGINE_H
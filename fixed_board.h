@@ -0,0 +1,176 @@
+// fixed_board.h
+// board with its size known at compile time, for faster AI search
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_FIXED_BOARD_H
+#define MANCALA_FIXED_BOARD_H
+
+#include <algorithm>
+#include <array>
+
+#include "search.h"
+
+namespace Mancala
+{
+    // smallest and largest board sizes with their own search kernel. other sizes use Simple_board
+    const int FIXED_MIN_BOWLS = 4;
+    const int FIXED_MAX_BOWLS = 8;
+
+    // same layout and rules as Simple_board, but with N fixed so loops can be unrolled and index math folded
+    template<int N>
+    class Fixed_board
+    {
+    public:
+        static const int num_bowls = N;
+        // number of bowls, including stores
+        static const int size = 2 * N + 2;
+
+        // copy of a Simple_board with N bowls
+        explicit Fixed_board(const Simple_board & b);
+
+        // perform a move
+        // returns true if the move earns an extra turn
+        bool move(const Mancala::Player p, const int i);
+        // is the game over
+        bool finished() const;
+        // heuristics to evaluate the board status for player 1
+        int evaluate() const;
+        // swap the players' sides, so player 2's position is seen as player 1's
+        void swap_sides()
+        {
+            std::swap_ranges(counts.begin(), counts.begin() + N + 1, counts.begin() + N + 1);
+            std::swap(totals[Mancala::PLAYER_1], totals[Mancala::PLAYER_2]);
+        }
+
+        // bowl / store for each player, indexed as in Board's bottom_row / top_row
+        int bowl(const Mancala::Player p, const int i) const
+        {
+            return counts[(p == Mancala::PLAYER_1)? i: 2 * N - i];
+        }
+        int store(const Mancala::Player p) const
+        {
+            return counts[(p == Mancala::PLAYER_1)? N: 2 * N + 1];
+        }
+
+        // board layout: <bottom row><r_store><top_row><l_store>
+        std::array<int, size> counts;
+        // beads in each player's bowls, not counting stores. indexed by Player
+        int totals[2];
+        bool extra_rule, capture_rule, collect_rule;
+    };
+
+    // copy of a Simple_board with N bowls
+    template<int N>
+    Fixed_board<N>::Fixed_board(const Simple_board & b):
+        extra_rule(b.extra_rule), capture_rule(b.capture_rule), collect_rule(b.collect_rule)
+    {
+        for(int i = 0; i < size; ++i)
+            counts[i] = b.bowls[i].count;
+        totals[Mancala::PLAYER_1] = b.totals[Mancala::PLAYER_1];
+        totals[Mancala::PLAYER_2] = b.totals[Mancala::PLAYER_2];
+    }
+
+    // perform a move
+    // returns true if the move earns an extra turn
+    template<int N>
+    bool Fixed_board<N>::move(const Mancala::Player p, const int i)
+    {
+        // get important indexes
+        int curr = (p == Mancala::PLAYER_1)? i: 2 * N - i;
+        const int store = (p == Mancala::PLAYER_1)? N: 2 * N + 1;
+        const int wrong_store = (p == Mancala::PLAYER_1)? 2 * N + 1: N;
+
+        // take beads from start and put into hand
+        int hand = counts[curr];
+        counts[curr] = 0;
+        totals[p] -= hand;
+
+        // each full lap puts one bead in every bowl but the opponent's store
+        if(hand >= size - 1)
+        {
+            int laps = hand / (size - 1);
+            for(int j = 0; j < size; ++j)
+                counts[j] += laps;
+            counts[wrong_store] -= laps;
+            totals[Mancala::PLAYER_1] += laps * N;
+            totals[Mancala::PLAYER_2] += laps * N;
+            hand %= size - 1;
+        }
+
+        // place the rest
+        while(hand > 0)
+        {
+            curr = (curr == size - 1)? 0: curr + 1;
+            // skip opponent's store
+            if(curr == wrong_store)
+                curr = (curr == size - 1)? 0: curr + 1;
+            ++counts[curr];
+            // player 2's bowls follow the r_store
+            if(curr != store)
+                ++totals[curr > N];
+            --hand;
+        }
+
+        // extra move when ending in our store
+        bool extra_move = false;
+        if(extra_rule && curr == store)
+            extra_move = true;
+
+        else if(capture_rule)
+        {
+            // collect last bead, and all beads across from it if we land in an empty bowl
+            // stores have nothing across from them
+            const int across = 2 * N - curr;
+            if(curr != store && counts[curr] == 1 && counts[across] > 0)
+            {
+                totals[curr > N] -= 1;
+                totals[across > N] -= counts[across];
+                counts[store] += counts[across] + 1;
+                counts[curr] = 0;
+                counts[across] = 0;
+            }
+        }
+
+        // when one side is empty, move all beads on the other side to that player's store
+        if(collect_rule)
+        {
+            if(totals[Mancala::PLAYER_1] == 0 && totals[Mancala::PLAYER_2] != 0)
+            {
+                for(int j = N + 1; j < 2 * N + 1; ++j)
+                    counts[j] = 0;
+                counts[2 * N + 1] += totals[Mancala::PLAYER_2];
+                totals[Mancala::PLAYER_2] = 0;
+            }
+            else if(totals[Mancala::PLAYER_2] == 0 && totals[Mancala::PLAYER_1] != 0)
+            {
+                for(int j = 0; j < N; ++j)
+                    counts[j] = 0;
+                counts[N] += totals[Mancala::PLAYER_1];
+                totals[Mancala::PLAYER_1] = 0;
+            }
+        }
+
+        return extra_move;
+    }
+
+    // is the game over
+    template<int N>
+    bool Fixed_board<N>::finished() const
+    {
+        return totals[Mancala::PLAYER_1] == 0 || totals[Mancala::PLAYER_2] == 0;
+    }
+
+    // heuristics to evaluate the board status for player 1
+    template<int N>
+    int Fixed_board<N>::evaluate() const
+    {
+        // with the collect rule, each side's remaining beads go to its owner at the end
+        int board_count = 0;
+        if(collect_rule)
+            board_count = totals[Mancala::PLAYER_1] - totals[Mancala::PLAYER_2];
+
+        return counts[N] - counts[2 * N + 1] + board_count;
+    }
+}
+
+#endif // MANCALA_FIXED_BOARD_H
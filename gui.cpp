@@ -2,6 +2,8 @@
 // GUI for mancala game, using gtkmm
 // Copyright Matthew Chandler 2014
 
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -20,24 +22,37 @@
 
 #include "config.h"
 #include "gui.h"
+#include "timeline.h"
+#include "trace.h"
 
 namespace Mancala
 {
+    // time spent measuring the AI's speed, in ms
+    const int CALIBRATION_MS = 300;
+
     Settings_win::Settings_win(Win * Win):
         p1_ai_check("Player 1 AI"),
         p2_ai_check("Player 2 AI"),
         board_size(Gtk::Adjustment::create(1.0, 1.0, 10.0)),
         board_seeds(Gtk::Adjustment::create(1.0, 1.0, 20.0)),
         ai_depth(Gtk::Adjustment::create(1.0, 0.0, 10.0)),
+        ai_target(Gtk::Adjustment::create(1.0, 0.1, 60.0, 0.1), 0.0, 1),
+        anim_speed(Gtk::Adjustment::create(0.0, 0.0, 500.0, 10.0)),
         board_size_label("Board size"),
         board_seeds_label("Seeds per bowl"),
         ai_depth_label("AI look-ahead"),
+        ai_target_label("Target AI time (s)"),
+        anim_speed_label("Animation (ms / bead)"),
         extra_rule_check("Extra move"),
         capture_rule_check("Capture beads"),
         collect_rule_check("Collect beads at end"),
         full_gui_radio("Full GUI"),
         simple_gui_radio("Simple_GUI"),
-        win(Win)
+        ai_auto_depth("Set look-ahead"),
+        win(Win),
+        calibration_stop(false),
+        calibration_stale(false),
+        have_cost(false)
     {
         set_default_size(300, 150);
         set_title("Mancala Settings");
@@ -54,8 +69,13 @@ namespace Mancala
         ai_depth_box.pack_start(ai_depth_label);
         ai_depth_box.pack_start(ai_depth);
 
-        get_content_area()->pack_start(ai_cycles_box, Gtk::PACK_EXPAND_PADDING);
-        ai_cycles_box.pack_start(ai_cycles);
+        get_content_area()->pack_start(ai_cost_box, Gtk::PACK_EXPAND_PADDING);
+        ai_cost_box.pack_start(ai_cost);
+
+        get_content_area()->pack_start(ai_target_box, Gtk::PACK_EXPAND_PADDING);
+        ai_target_box.pack_start(ai_target_label, Gtk::PACK_EXPAND_PADDING);
+        ai_target_box.pack_start(ai_target, Gtk::PACK_EXPAND_PADDING);
+        ai_target_box.pack_start(ai_auto_depth, Gtk::PACK_EXPAND_PADDING);
 
         get_content_area()->pack_start(main_1_sep);
 
@@ -77,15 +97,21 @@ namespace Mancala
         get_content_area()->pack_start(gui_box);
         gui_box.pack_start(full_gui_radio, Gtk::PACK_EXPAND_PADDING);
         gui_box.pack_start(simple_gui_radio, Gtk::PACK_EXPAND_PADDING);
+        gui_box.pack_start(anim_box, Gtk::PACK_EXPAND_PADDING);
+        anim_box.pack_start(anim_speed_label);
+        anim_box.pack_start(anim_speed);
 
         // set tooltips
         ai_depth.set_tooltip_text("How many steps the AI looks ahead.\nMore steps will make the AI more difficult, but will make it take more time");
-        ai_cycles.set_tooltip_text("Worse case number of AI look-ahead computations given board size and look-ahead");
+        ai_cost.set_tooltip_text("How long the AI takes to move, measured on this computer with these settings");
+        ai_target.set_tooltip_text("How long you're willing to wait for the AI to move");
+        ai_auto_depth.set_tooltip_text("Use the highest AI look-ahead predicted to move within the target time");
         extra_rule_check.set_tooltip_text("Get an extra move when last bead placed in store");
         capture_rule_check.set_tooltip_text("When landing in an empty bowl, capture all beads across from it");
         collect_rule_check.set_tooltip_text("At the end of the game, players collect any beads left on their side");
         full_gui_radio.set_tooltip_text("Use a full, graphical GUI");
         simple_gui_radio.set_tooltip_text("Use a simple, button-based GUI");
+        anim_speed.set_tooltip_text("How long each bead takes to move in the full GUI. Set to 0 to disable animation");
 
         // pack the buttons
         add_button("OK", Gtk::RESPONSE_OK);
@@ -100,8 +126,23 @@ namespace Mancala
         // set signal handlers
         signal_response().connect(sigc::mem_fun(*this, &Settings_win::button_func));
         signal_show().connect(sigc::mem_fun(*this, &Settings_win::open));
-        ai_depth.signal_value_changed().connect(sigc::mem_fun(*this, &Settings_win::ai_cycles_func));
-        board_size.signal_value_changed().connect(sigc::mem_fun(*this, &Settings_win::ai_cycles_func));
+        ai_depth.signal_value_changed().connect(sigc::mem_fun(*this, &Settings_win::ai_cost_func));
+        ai_auto_depth.signal_clicked().connect(sigc::mem_fun(*this, &Settings_win::auto_depth_func));
+        // the AI's speed depends on the board and rules, so measure again when they change
+        board_size.signal_value_changed().connect(sigc::mem_fun(*this, &Settings_win::calibrate_func));
+        board_seeds.signal_value_changed().connect(sigc::mem_fun(*this, &Settings_win::calibrate_func));
+        extra_rule_check.signal_toggled().connect(sigc::mem_fun(*this, &Settings_win::calibrate_func));
+        capture_rule_check.signal_toggled().connect(sigc::mem_fun(*this, &Settings_win::calibrate_func));
+        collect_rule_check.signal_toggled().connect(sigc::mem_fun(*this, &Settings_win::calibrate_func));
+    }
+
+    // stop any calibration in progress
+    Settings_win::~Settings_win()
+    {
+        calibrate_sig.disconnect();
+        calibration_stop = true;
+        if(calibration.valid())
+            calibration.wait();
     }
 
     // callback for settings window okay button
@@ -118,6 +159,8 @@ namespace Mancala
             win->extra_rule = extra_rule_check.get_active();
             win->capture_rule = capture_rule_check.get_active();
             win->collect_rule = collect_rule_check.get_active();
+            win->anim_ms = (int)anim_speed.get_value();
+            win->draw.anim_step_ms = win->anim_ms;
 
             // set gui type by setting menu item
             // this, in turn, calls its callback function which takes care of
@@ -139,6 +182,7 @@ namespace Mancala
         board_size.set_value((double)win->num_bowls);
         board_seeds.set_value((double)win->num_seeds);
         ai_depth.set_value((double)win->ai_depth);
+        anim_speed.set_value((double)win->anim_ms);
         // set checkbox values
         p1_ai_check.set_active(win->p1_ai);
         p2_ai_check.set_active(win->p2_ai);
@@ -152,22 +196,77 @@ namespace Mancala
         else
             simple_gui_radio.set_active();
 
-        ai_cycles_func();
+        calibrate_func();
     }
 
-    // update # of ai cycles
-    void Settings_win::ai_cycles_func()
+    // show the predicted time for the AI to move
+    void Settings_win::ai_cost_func()
     {
-        double num_cycles = pow(board_size.get_value(), ai_depth.get_value() + 1.0);
-        std::ostringstream cycle_str;
-        cycle_str<<"AI search space: "<<num_cycles<<" evals";
-        if(num_cycles > 1e9)
-            cycle_str<<" - Not Recommended";
-        ai_cycles.set_text(cycle_str.str());
+        if(!have_cost)
+        {
+            ai_cost.set_text("Measuring AI speed...");
+            return;
+        }
+
+        double secs = cost.predict((int)ai_depth.get_value());
+        std::ostringstream cost_str;
+        cost_str<<std::setprecision(2)<<"Predicted AI time: "<<secs<<" s / move";
+        if(secs > 10.0)
+            cost_str<<" - Not Recommended";
+        ai_cost.set_text(cost_str.str());
     }
 
-    Win::Win():
-        settings_win(this),
+    // measure the AI's speed for the board and rules chosen
+    // the measurement runs in the background. a change while it runs starts a new one once it stops
+    void Settings_win::calibrate_func()
+    {
+        have_cost = false;
+        calibration_stale = true;
+        calibration_stop = true;
+        ai_auto_depth.set_sensitive(false);
+        ai_cost_func();
+        if(!calibrate_sig.connected())
+            calibrate_sig = Glib::signal_timeout().connect(sigc::mem_fun(*this, &Settings_win::calibrate_poll), 100);
+    }
+
+    // check on the measurement of the AI's speed. Executed on a timer
+    bool Settings_win::calibrate_poll()
+    {
+        if(calibration.valid())
+        {
+            if(calibration.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return true;
+
+            Search_cost new_cost = calibration.get();
+            if(!calibration_stale)
+            {
+                cost = new_cost;
+                have_cost = true;
+                ai_auto_depth.set_sensitive(true);
+                ai_cost_func();
+            }
+        }
+
+        if(!calibration_stale)
+            return false;
+
+        calibration_stale = false;
+        calibration_stop = false;
+        calibration = std::async(std::launch::async, calibrate, (int)board_size.get_value(),
+            (int)board_seeds.get_value(), extra_rule_check.get_active(), capture_rule_check.get_active(),
+            collect_rule_check.get_active(), CALIBRATION_MS, &calibration_stop);
+        return true;
+    }
+
+    // set the look-ahead to the deepest that fits in the target time
+    void Settings_win::auto_depth_func()
+    {
+        if(have_cost)
+            ai_depth.set_value(cost.deepest_within(ai_target.get_value(),
+                (int)ai_depth.get_adjustment()->get_upper()));
+    }
+
+    Win::Win(const std::uint64_t Seed, const std::string & Record_path):
         player(PLAYER_1),
         game_over(false),
         p1_ai(false),
@@ -179,8 +278,41 @@ namespace Mancala
         capture_rule(true),
         collect_rule(true),
         full_gui(true),
-        draw(num_bowls, num_seeds, ai_depth, extra_rule, capture_rule, collect_rule)
+        anim_ms(60),
+        simple_gui_built(false),
+        simple_gui_stale(true),
+        simple_l_count(-1),
+        simple_r_count(-1),
+        simple_hint_bowl(NULL),
+        hint_upgrading(false),
+        hint_depth(0),
+        seed_rng(Seed),
+        draw(num_bowls, num_seeds, ai_depth, extra_rule, capture_rule, collect_rule, seed_rng.next())
     {
+        startup_timeline.mark("drawing area constructed");
+
+        draw.anim_step_ms = anim_ms;
+
+        // open the game record, and start recording the first game
+        if(!Record_path.empty())
+        {
+            // a game left open by a crash would swallow the next game's header
+            if(!end_partial_game(Record_path))
+                std::cerr<<"Could not fix the unfinished game at the end of "<<Record_path<<". Not recording"
+                    <<std::endl;
+            else
+            {
+                record_file.reset(new std::ofstream(Record_path.c_str(), std::ios::binary | std::ios::app));
+                if(*record_file)
+                {
+                    record.reset(new Record_writer(*record_file));
+                    record->begin_game(board_header(draw.b));
+                }
+                else
+                    std::cerr<<"Could not open "<<Record_path<<" for recording"<<std::endl;
+            }
+        }
+
         // set window properties
         set_default_size(800,400);
         set_title(MANCALA_TITLE);
@@ -235,7 +367,7 @@ namespace Mancala
 
         Gtk::MenuItem * game_settings = Gtk::manage(new Gtk::MenuItem("_Settings", true));
         game_menu->append(*game_settings);
-        game_settings->signal_activate().connect(sigc::mem_fun(settings_win, &Settings_win::show));
+        game_settings->signal_activate().connect(sigc::mem_fun(*this, &Win::show_settings));
 
         game_menu->append(*Gtk::manage(new Gtk::SeparatorMenuItem));
 
@@ -265,6 +397,13 @@ namespace Mancala
         display_menu->append(*display_simple_gui);
         display_simple_gui->signal_activate().connect(sigc::mem_fun(*this, &Win::gui_f));
 
+        display_menu->append(*Gtk::manage(new Gtk::SeparatorMenuItem));
+
+        display_stats.reset(new Gtk::CheckMenuItem("Render _Stats", true));
+        display_stats->set_active(draw.show_stats);
+        display_menu->append(*display_stats);
+        display_stats->signal_activate().connect(sigc::mem_fun(*this, &Win::stats_f));
+
         // "Help" Menu
         Gtk::MenuItem * help_about = Gtk::manage(new Gtk::MenuItem("_About", true));
         help_menu->append(*help_about);
@@ -296,11 +435,13 @@ namespace Mancala
         settings_button->set_icon_name("preferences-desktop");
         settings_button->set_tooltip_text("Game settings");
         settings_button->set_use_underline(true);
-        settings_button->signal_clicked().connect(sigc::mem_fun(settings_win, &Settings_win::show));
+        settings_button->signal_clicked().connect(sigc::mem_fun(*this, &Win::show_settings));
 
         tool_bar->show();
         tool_bar->show_all_children();
 
+        startup_timeline.mark("menus and toolbar built");
+
         main_box.pack_start(draw);
         draw.show();
 
@@ -311,28 +452,16 @@ namespace Mancala
         simple_gui_box.pack_start(simple_sub_board_box);
         simple_sub_board_box.pack_start(simple_top_row_box);
         simple_sub_board_box.pack_start(simple_bottom_row_box);
-
-        // create and store widgets for the bowls
-        // bind events to each button
-        for(int i = 0; i < num_bowls; ++i)
-        {
-            simple_top_row_bowls.push_back(std::unique_ptr<Gtk::Button>(new Gtk::Button));
-            simple_top_row_box.pack_start(*simple_top_row_bowls[i]);
-            simple_top_row_bowls.back()->signal_clicked().connect(sigc::bind<Player, int>
-                (sigc::mem_fun(*this, &Win::simple_button_click), PLAYER_2, i));
-
-            simple_bottom_row_bowls.push_back(std::unique_ptr<Gtk::Button>(new Gtk::Button));
-            simple_bottom_row_box.pack_start(*simple_bottom_row_bowls[i]);
-            simple_bottom_row_bowls.back()->signal_clicked().connect(sigc::bind<Player, int>
-                (sigc::mem_fun(*this, &Win::simple_button_click), PLAYER_1, i));
-        }
-
-        simple_gui_box.show_all_children();
+        // bowl buttons are created the first time the simple gui is shown
 
         main_box.pack_end(player_label, Gtk::PACK_SHRINK);
         player_label.show();
         main_box.show();
 
+        // report startup times after the first frame
+        if(startup_timeline.enabled)
+            first_draw_sig = signal_draw().connect(sigc::mem_fun(*this, &Win::first_draw), false);
+
         // set callback for mouse click in drawing area
         draw.signal_button_press_event().connect(sigc::mem_fun(*this, &Win::mouse_down));
         // set timer to make AI moves when able. Check every 500ms
@@ -361,7 +490,7 @@ namespace Mancala
                     draw.show_hint = false;
                     ai_sig.disconnect();
                     hint_sig.disconnect();
-                    if(!draw.b.move(PLAYER_1, grid_x - 1))
+                    if(!play_move(PLAYER_1, grid_x - 1))
                         player = PLAYER_2;
                 }
                 else if(!p2_ai && player == PLAYER_2 && grid_y == 0 && draw.b.top_row[grid_x - 1].beads.size() > 0)
@@ -369,7 +498,7 @@ namespace Mancala
                     draw.show_hint = false;
                     ai_sig.disconnect();
                     hint_sig.disconnect();
-                    if(!draw.b.move(PLAYER_2, grid_x - 1))
+                    if(!play_move(PLAYER_2, grid_x - 1))
                         player = PLAYER_1;
                 }
                 update_board();
@@ -378,6 +507,14 @@ namespace Mancala
         return true;
     }
 
+    // make a move on the board, and record it
+    bool Win::play_move(const Player p, const int i)
+    {
+        if(record)
+            record->add_move(p, i);
+        return draw.b.move(p, i);
+    }
+
     // check to see if AI player can move. Executed on a timer
     bool Win::ai_timer()
     {
@@ -386,14 +523,42 @@ namespace Mancala
         else
         {
             update_f.clear();
+
+            // replace a hint from a partial search as deeper results come in
+            if(hint_upgrading)
+            {
+                if(draw.show_hint && !game_over)
+                    background_hint();
+                else
+                    hint_upgrading = false;
+            }
+
             if(!game_over && !ai_sig.connected())
             {
                 if((player == PLAYER_1 && p1_ai) || (player == PLAYER_2 && p2_ai))
                 {
                     draw.show_hint = false;
                     hint_sig.disconnect();
-                    ai_sig = draw.b.signal_choosemove().connect(sigc::mem_fun(*this, &Win::ai_move));
-                    ai_thread_id = draw.b.choosemove_noblock(player);
+
+                    Background_job job(Simple_board(draw.b), player, draw.b.ai_depth);
+                    Search_result result;
+                    // answer right away if we searched this position while the human was thinking
+                    if(background.find(job, result))
+                    {
+                        background.cancel();
+                        if(!play_move(player, draw.b.pick_move(player, result.moves)))
+                            player = (player == PLAYER_1)? PLAYER_2: PLAYER_1;
+                        update_board();
+                    }
+                    // still being searched. drop the other replies and wait for it
+                    else if(background.pending(job))
+                        background.keep(job);
+                    else
+                    {
+                        background.cancel();
+                        ai_sig = draw.b.signal_choosemove().connect(sigc::mem_fun(*this, &Win::ai_move));
+                        ai_thread_id = draw.b.choosemove_noblock(player);
+                    }
                 }
             }
         }
@@ -406,7 +571,7 @@ namespace Mancala
         // did we get the last thread we sent off?
         if(id == ai_thread_id)
         {
-            bool ai_extra_move = draw.b.move(player, i);
+            bool ai_extra_move = play_move(player, i);
 
             if(!ai_extra_move)
             {
@@ -432,7 +597,7 @@ namespace Mancala
                 draw.show_hint = false;
                 ai_sig.disconnect();
                 hint_sig.disconnect();
-                if(!draw.b.move(PLAYER_1, i))
+                if(!play_move(PLAYER_1, i))
                     player = PLAYER_2;
             }
             else if(!p2_ai && player == PLAYER_2 && p == PLAYER_2 && draw.b.top_row[i].beads.size() > 0)
@@ -440,7 +605,7 @@ namespace Mancala
                 draw.show_hint = false;
                 ai_sig.disconnect();
                 hint_sig.disconnect();
-                if(!draw.b.move(PLAYER_2, i))
+                if(!play_move(PLAYER_2, i))
                     player = PLAYER_1;
             }
             update_board();
@@ -455,6 +620,9 @@ namespace Mancala
         game_hint->set_sensitive(false);
         hint_button->set_sensitive(false);
 
+        if(record)
+            record->end_game();
+
         // create and show a dialog announcing the winner
         Glib::ustring msg;
 
@@ -477,6 +645,9 @@ namespace Mancala
     {
         if(hint_sig.connected() || game_over || (player == PLAYER_1 && p1_ai) || (player == PLAYER_2 && p2_ai))
             return;
+        // use the background search if it's got anywhere
+        if(background_hint())
+            return;
         ai_sig.disconnect();
         hint_sig = draw.b.signal_choosemove().connect(sigc::mem_fun(*this, &Win::hint_done));
         ai_thread_id = draw.b.choosemove_noblock(player);
@@ -491,11 +662,37 @@ namespace Mancala
             draw.hint_i = i;
             draw.show_hint = true;
             draw.hint_player = player;
+            hint_depth = draw.b.ai_depth;
             update_f.test_and_set();
             hint_sig.disconnect();
         }
     }
 
+    // show the background search's hint for this position, if it's deeper than the hint shown
+    // returns false if the background search has no result for this position
+    bool Win::background_hint()
+    {
+        Background_job job(Simple_board(draw.b), player, draw.b.ai_depth);
+        Search_result result;
+        if(!background.find(job, result, true))
+        {
+            hint_upgrading = false;
+            return false;
+        }
+
+        // keep checking for deeper results until the full look-ahead is done
+        hint_upgrading = result.depth < job.depth;
+        if(!draw.show_hint || result.depth > hint_depth)
+        {
+            draw.hint_i = draw.b.pick_move(player, result.moves);
+            draw.show_hint = true;
+            draw.hint_player = player;
+            hint_depth = result.depth;
+            update_board();
+        }
+        return true;
+    }
+
     // start a new game
     void Win::new_game()
     {
@@ -505,44 +702,123 @@ namespace Mancala
         hint_button->set_sensitive(true);
 
         player = PLAYER_1;
-        draw.b = Board(num_bowls, num_seeds, ai_depth, extra_rule, capture_rule, collect_rule);
+        background.cancel();
+        background.clear();
+        draw.stop_animation();
+        draw.b = Board(num_bowls, num_seeds, ai_depth, extra_rule, capture_rule, collect_rule, seed_rng.next());
+
+        // an unfinished game is kept in the record, ended where it was abandoned
+        if(record)
+            record->begin_game(board_header(draw.b));
 
-        // rebuild simple_gui
-        for(size_t i = 0; i < simple_top_row_bowls.size(); ++i)
+        // resize simple_gui, if it's been built
+        if(simple_gui_built)
+            build_simple_gui();
+
+        draw.show_hint = false;
+        ai_sig.disconnect();
+        hint_sig.disconnect();
+        draw.queue_draw();
+        update_board();
+    }
+
+    // create the bowl buttons for the simple gui, or add / remove buttons to match the board size
+    // existing buttons are reused
+    void Win::build_simple_gui()
+    {
+        // remove buttons past the end of the board
+        while((int)simple_top_row_bowls.size() > draw.b.num_bowls)
         {
-            simple_top_row_box.remove(*simple_top_row_bowls[i]);
-            simple_bottom_row_box.remove(*simple_bottom_row_bowls[i]);
+            if(simple_hint_bowl == simple_top_row_bowls.back().get()
+                || simple_hint_bowl == simple_bottom_row_bowls.back().get())
+                simple_hint_bowl = NULL;
+
+            simple_top_row_box.remove(*simple_top_row_bowls.back());
+            simple_bottom_row_box.remove(*simple_bottom_row_bowls.back());
+            simple_top_row_bowls.pop_back();
+            simple_bottom_row_bowls.pop_back();
         }
 
-        simple_top_row_bowls.clear();
-        simple_bottom_row_bowls.clear();
-
-        // create and store widgets for the bowls
+        // create and store widgets for any new bowls
         // bind events to each button
-        for(int i = 0; i < num_bowls; ++i)
+        for(int i = simple_top_row_bowls.size(); i < draw.b.num_bowls; ++i)
         {
             simple_top_row_bowls.push_back(std::unique_ptr<Gtk::Button>(new Gtk::Button));
             simple_top_row_box.pack_start(*simple_top_row_bowls[i]);
             simple_top_row_bowls.back()->signal_clicked().connect(sigc::bind<Player, int>
                 (sigc::mem_fun(*this, &Win::simple_button_click), PLAYER_2, i));
+            simple_top_row_bowls.back()->show();
 
             simple_bottom_row_bowls.push_back(std::unique_ptr<Gtk::Button>(new Gtk::Button));
             simple_bottom_row_box.pack_start(*simple_bottom_row_bowls[i]);
             simple_bottom_row_bowls.back()->signal_clicked().connect(sigc::bind<Player, int>
                 (sigc::mem_fun(*this, &Win::simple_button_click), PLAYER_1, i));
+            simple_bottom_row_bowls.back()->show();
         }
 
-        simple_gui_box.show_all_children();
+        if(!simple_gui_built)
+        {
+            simple_gui_box.show_all_children();
+            simple_gui_built = true;
+            startup_timeline.mark("simple GUI built");
+        }
 
-        draw.show_hint = false;
-        ai_sig.disconnect();
-        hint_sig.disconnect();
-        update_board();
+        simple_gui_stale = true;
+    }
+
+    // update the simple gui widget for a bowl / store, if its count changed
+    void Win::update_simple_bowl(const Bowl & bowl)
+    {
+        int count = bowl.beads.size();
+        int * shown_count = NULL;
+        Gtk::Label * label = NULL;
+        Gtk::Button * button = NULL;
+
+        // find the widget for this bowl
+        if(&bowl == &draw.b.l_store)
+        {
+            shown_count = &simple_l_count;
+            label = &simple_l_store;
+        }
+        else if(&bowl == &draw.b.r_store)
+        {
+            shown_count = &simple_r_count;
+            label = &simple_r_store;
+        }
+        else
+        {
+            // index straight into the row the bowl is in
+            std::less<const Bowl *> before;
+            const Bowl * top = draw.b.top_row.data(), * bottom = draw.b.bottom_row.data();
+            int n = draw.b.num_bowls;
+            if(!before(&bowl, top) && before(&bowl, top + n))
+            {
+                shown_count = &simple_top_counts[&bowl - top];
+                button = simple_top_row_bowls[&bowl - top].get();
+            }
+            else if(!before(&bowl, bottom) && before(&bowl, bottom + n))
+            {
+                shown_count = &simple_bottom_counts[&bowl - bottom];
+                button = simple_bottom_row_bowls[&bowl - bottom].get();
+            }
+        }
+
+        if(!shown_count || *shown_count == count)
+            return;
+
+        *shown_count = count;
+        std::ostringstream count_str;
+        count_str<<count;
+        if(label)
+            label->set_text(count_str.str());
+        else
+            button->set_label(count_str.str());
     }
 
     // update the numbers for each bowl / store
     void Win::update_board()
     {
+        Trace_span span("update_board");
         // Show whose turn it is
         if(player == PLAYER_1)
             player_label.set_text("Player 1");
@@ -553,40 +829,52 @@ namespace Mancala
         players_1_ai->set_active(p1_ai);
         players_2_ai->set_active(p2_ai);
 
-        // call for a redraw
+        // call for a redraw of whatever changed
         if(full_gui)
-            draw.queue_draw();
+            draw.queue_draw_changed();
         else
         {
             // update labels and buttons for simple gui
-            std::ostringstream l_store_str, r_store_str;
-            l_store_str<<draw.b.l_store.beads.size();
-            simple_l_store.set_text(l_store_str.str());
-
-            r_store_str<<draw.b.r_store.beads.size();
-            simple_r_store.set_text(r_store_str.str());
-
-            for(int i = 0; i < num_bowls; ++i)
+            // only bowls a move changed need checked, unless everything needs refreshed
+            if(simple_gui_stale)
             {
-                std::ostringstream top_count_str, bottom_count_str;
-                top_count_str<<draw.b.top_row[i].beads.size();
-                simple_top_row_bowls[i]->set_label(top_count_str.str());
+                simple_l_count = simple_r_count = -1;
+                simple_top_counts.assign(draw.b.num_bowls, -1);
+                simple_bottom_counts.assign(draw.b.num_bowls, -1);
 
-                bottom_count_str<<draw.b.bottom_row[i].beads.size();
-                simple_bottom_row_bowls[i]->set_label(bottom_count_str.str());
-
-                // clear hint highlighting
-                simple_top_row_bowls[i]->drag_unhighlight();
-                simple_bottom_row_bowls[i]->drag_unhighlight();
+                update_simple_bowl(draw.b.l_store);
+                update_simple_bowl(draw.b.r_store);
+                for(int i = 0; i < draw.b.num_bowls; ++i)
+                {
+                    update_simple_bowl(draw.b.top_row[i]);
+                    update_simple_bowl(draw.b.bottom_row[i]);
+                }
+                simple_gui_stale = false;
+            }
+            else
+            {
+                for(auto & i: draw.b.changed_bowls)
+                    update_simple_bowl(*i);
             }
+            draw.b.changed_bowls.clear();
+            draw.b.sow_log.clear();
 
-            // set hint highlighting
+            // move hint highlighting
+            Gtk::Button * new_hint_bowl = NULL;
             if(draw.show_hint)
             {
                 if(draw.hint_player == PLAYER_1)
-                    simple_bottom_row_bowls[draw.hint_i]->drag_highlight();
+                    new_hint_bowl = simple_bottom_row_bowls[draw.hint_i].get();
                 else
-                    simple_top_row_bowls[draw.hint_i]->drag_highlight();
+                    new_hint_bowl = simple_top_row_bowls[draw.hint_i].get();
+            }
+            if(new_hint_bowl != simple_hint_bowl)
+            {
+                if(simple_hint_bowl)
+                    simple_hint_bowl->drag_unhighlight();
+                if(new_hint_bowl)
+                    new_hint_bowl->drag_highlight();
+                simple_hint_bowl = new_hint_bowl;
             }
         }
 
@@ -594,6 +882,9 @@ namespace Mancala
         if(!game_over && draw.b.finished())
             disp_winner();
 
+        if(!game_over)
+            start_background();
+
         update_f.clear();
     }
 
@@ -603,6 +894,7 @@ namespace Mancala
         p1_ai = players_1_ai->get_active();
         ai_sig.disconnect();
         hint_sig.disconnect();
+        background.cancel();
     }
 
     void Win::p2_ai_menu_f()
@@ -610,6 +902,38 @@ namespace Mancala
         p2_ai = players_2_ai->get_active();
         ai_sig.disconnect();
         hint_sig.disconnect();
+        background.cancel();
+    }
+
+    // while a human is to move, search for their hint, and the AI's reply to each of their moves
+    void Win::start_background()
+    {
+        Player ai_player = (player == PLAYER_1)? PLAYER_2: PLAYER_1;
+        bool human_to_move = (player == PLAYER_1)? !p1_ai: !p2_ai;
+        bool ai_next = (ai_player == PLAYER_1)? p1_ai: p2_ai;
+
+        Simple_board b(draw.b);
+        if(!human_to_move)
+        {
+            // only the search for the AI's move is still useful
+            background.keep(Background_job(b, player, draw.b.ai_depth));
+            return;
+        }
+
+        std::vector<Background_job> jobs;
+        // the hint for this position first, so Hint is instant
+        jobs.push_back(Background_job(b, player, draw.b.ai_depth));
+
+        // moves that earn an extra turn are skipped. the position after them is pondered once it's played
+        for(int i = 0; ai_next && i < b.num_bowls; ++i)
+        {
+            if(b.bowl(player, i) == 0)
+                continue;
+            Simple_board sub_b = b;
+            if(!sub_b.move(player, i) && !sub_b.finished())
+                jobs.push_back(Background_job(sub_b, ai_player, draw.b.ai_depth));
+        }
+        background.replace(jobs);
     }
 
     // GUI menu callback
@@ -621,10 +945,13 @@ namespace Mancala
             draw.show();
             simple_gui_box.hide();
             resize(800,400);
+            draw.queue_draw();
             update_board();
         }
         else if(display_simple_gui->get_active() && full_gui)
         {
+            build_simple_gui();
+            simple_gui_stale = true;
             full_gui = false;
             draw.hide();
             simple_gui_box.show();
@@ -633,6 +960,30 @@ namespace Mancala
         }
     }
 
+    // render stats menu callback
+    void Win::stats_f()
+    {
+        draw.show_stats = display_stats->get_active();
+        draw.queue_draw();
+    }
+
+    // settings menu callback. the settings window is created on first use
+    void Win::show_settings()
+    {
+        if(!settings_win)
+            settings_win.reset(new Settings_win(this));
+        settings_win->show();
+    }
+
+    // print startup times once the window is first drawn
+    bool Win::first_draw(const Cairo::RefPtr<Cairo::Context> & cr)
+    {
+        startup_timeline.mark("first frame");
+        startup_timeline.print(std::cout);
+        first_draw_sig.disconnect();
+        return false;
+    }
+
     // about menu callback
     void Win::about()
     {
@@ -6,7 +6,10 @@
 #define MANCALA_GUI_H
 
 #include <atomic>
+#include <fstream>
+#include <future>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -24,8 +27,10 @@
 #include <gtkmm/button.h>
 #include <gtkmm/box.h>
 
+#include "background.h"
 #include "board.h"
 #include "draw.h"
+#include "record.h"
 
 namespace Mancala
 {
@@ -36,44 +41,66 @@ namespace Mancala
     {
     public:
         Settings_win(Win * Win);
+        ~Settings_win();
 
         // callback for settings window OK button
         void button_func(int response_id);
         // callback for settings window open
         void open();
-        // update # of ai cycles
-        void ai_cycles_func();
+        // show the predicted time for the AI to move
+        void ai_cost_func();
+        // measure the AI's speed for the board and rules chosen
+        void calibrate_func();
+        // check on the measurement of the AI's speed
+        bool calibrate_poll();
+        // set the look-ahead to the deepest that fits in the target time
+        void auto_depth_func();
 
         // containers
         Gtk::HBox ai_box;
         Gtk::VBox ai_check_box;
         Gtk::VBox ai_depth_box;
-        Gtk::HBox ai_cycles_box;
+        Gtk::HBox ai_cost_box;
+        Gtk::HBox ai_target_box;
         Gtk::HBox board_box;
         Gtk::VBox l_board_box;
         Gtk::VBox r_board_box;
         Gtk::HBox rule_box;
         Gtk::HBox gui_box;
+        Gtk::VBox anim_box;
 
         Gtk::HSeparator main_1_sep, main_2_sep;
         Gtk::VSeparator ai_sep;
 
         // widgets
         Gtk::CheckButton p1_ai_check, p2_ai_check;
-        Gtk::SpinButton board_size, board_seeds, ai_depth;
-        Gtk::Label board_size_label, board_seeds_label, ai_depth_label;
-        Gtk::Label ai_cycles;
+        Gtk::SpinButton board_size, board_seeds, ai_depth, ai_target, anim_speed;
+        Gtk::Label board_size_label, board_seeds_label, ai_depth_label, ai_target_label, anim_speed_label;
+        Gtk::Label ai_cost;
         Gtk::CheckButton extra_rule_check, capture_rule_check, collect_rule_check;
         Gtk::RadioButton full_gui_radio, simple_gui_radio;
+        Gtk::Button ai_auto_depth;
 
     private:
         Win * win;
+
+        // measurement of the AI's speed, run in the background
+        std::future<Search_cost> calibration;
+        std::atomic<bool> calibration_stop;
+        // settings changed since the running measurement started
+        bool calibration_stale;
+        sigc::connection calibrate_sig;
+        // latest measurement, valid if have_cost is set
+        bool have_cost;
+        Search_cost cost;
     };
 
     class Win: public Gtk::Window
     {
     public:
-        Win();
+        // Seed is used to generate the seed for each game
+        // if Record_path is given, every game played is appended to it
+        Win(const std::uint64_t Seed, const std::string & Record_path = "");
 
         friend class Settings_win;
 
@@ -101,6 +128,10 @@ namespace Mancala
 
         // GUI menu callbacks
         void gui_f();
+        void stats_f();
+
+        // settings menu callback
+        void show_settings();
 
         // about menu callback
         void about();
@@ -124,17 +155,33 @@ namespace Mancala
 
         // GUI selection menu item
         std::unique_ptr<Gtk::RadioMenuItem> display_full_gui, display_simple_gui;
+        // render stats menu item
+        std::unique_ptr<Gtk::CheckMenuItem> display_stats;
 
         // hint items (saved so we can disable them)
         std::unique_ptr<Gtk::MenuItem> game_hint;
         std::unique_ptr<Gtk::ToolButton> hint_button;
 
-        // settings window
-        Settings_win settings_win;
+        // settings window, created on first use
+        std::unique_ptr<Settings_win> settings_win;
 
     private:
+        // make a move on the board, and record it
+        // returns true if the move earns an extra turn
+        bool play_move(const Player p, const int i);
         // update the numbers for each bowl / store
         void update_board();
+        // create the bowl buttons for the simple gui, or add / remove buttons to match the board size
+        void build_simple_gui();
+        // update the simple gui widget for a bowl / store, if its count changed
+        void update_simple_bowl(const Bowl & bowl);
+        // search for a hint, and the AI's replies to the human's moves, while they think
+        void start_background();
+        // show the background search's hint for this position
+        // returns false if the background search has no result for it
+        bool background_hint();
+        // print startup times once the window is first drawn
+        bool first_draw(const Cairo::RefPtr<Cairo::Context> & cr);
 
         // state vars
         Player player;
@@ -147,10 +194,35 @@ namespace Mancala
         int ai_depth;
         bool extra_rule, capture_rule, collect_rule;
         bool full_gui;
+        // time per bead when animating moves, in ms. 0 to disable
+        int anim_ms;
+        // simple gui bowl buttons have been created
+        bool simple_gui_built;
+        // counts last shown in the simple gui, so only changed widgets are updated
+        // set simple_gui_stale to refresh every widget
+        bool simple_gui_stale;
+        int simple_l_count, simple_r_count;
+        std::vector<int> simple_top_counts, simple_bottom_counts;
+        Gtk::Button * simple_hint_bowl;
+        // the hint shown came from a partial background search, so may be replaced with a deeper one
+        bool hint_upgrading;
+        // look-ahead of the hint shown
+        int hint_depth;
+        sigc::connection first_draw_sig;
 
         // flag set when update_board needs called
         std::atomic_flag update_f;
 
+        // generates the seed for each new game
+        Rng seed_rng;
+
+        // hints and AI replies searched while the human player thinks
+        Background_search background;
+
+        // game record output. NULL when not recording
+        std::unique_ptr<std::ofstream> record_file;
+        std::unique_ptr<Record_writer> record;
+
         // id of the thread running the ai search.
         // makes sure we get the result one back
         std::thread::id ai_thread_id;
@@ -0,0 +1,201 @@
+// record.cpp
+// compact binary game records
+// Copyright Matthew Chandler 2014
+
+#include <fstream>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "record.h"
+
+const unsigned char record_version = 1;
+const unsigned char end_of_game = 0xFF;
+
+namespace Mancala
+{
+    unsigned char encode_move(const Player p, const int i)
+    {
+        return (unsigned char)i | ((p == PLAYER_2)? 0x80 : 0x00);
+    }
+
+    // header for a game played on the given board
+    Game_header board_header(const Board & b)
+    {
+        Game_header header;
+        header.num_bowls = b.num_bowls;
+        header.num_beads = b.num_beads;
+        header.extra_rule = b.extra_rule;
+        header.capture_rule = b.capture_rule;
+        header.collect_rule = b.collect_rule;
+        header.seed = b.seed;
+        return header;
+    }
+
+    Record_writer::Record_writer(std::ostream & Out):
+        out(Out),
+        in_game(false)
+    {}
+
+    Record_writer::~Record_writer()
+    {
+        end_game();
+    }
+
+    // start a new game, ending any game in progress
+    void Record_writer::begin_game(const Game_header & header)
+    {
+        end_game();
+
+        if(header.num_bowls >= 127 || header.num_beads > 255)
+            throw std::invalid_argument("board too large to record");
+
+        unsigned char raw[14];
+        raw[0] = 'M';
+        raw[1] = 'G';
+        raw[2] = record_version;
+        raw[3] = (header.extra_rule? 1 : 0) | (header.capture_rule? 2 : 0) | (header.collect_rule? 4 : 0);
+        raw[4] = header.num_bowls;
+        raw[5] = header.num_beads;
+        for(int i = 0; i < 8; ++i)
+            raw[6 + i] = (header.seed >> (8 * i)) & 0xFF;
+
+        out.write((const char *)raw, sizeof(raw));
+        out.flush();
+        in_game = true;
+    }
+
+    // append a move to the game in progress, and flush it to the stream
+    // moves are at most a few a second, so the flush costs nothing noticeable
+    void Record_writer::add_move(const Player p, const int i)
+    {
+        if(in_game)
+        {
+            out.put(encode_move(p, i));
+            out.flush();
+        }
+    }
+
+    // end the game in progress, and flush it to the stream
+    void Record_writer::end_game()
+    {
+        if(in_game)
+        {
+            out.put(end_of_game);
+            out.flush();
+            in_game = false;
+        }
+    }
+
+    // add the end marker to a game left unfinished at the end of a record file, so more games can be appended
+    bool end_partial_game(const std::string & path)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if(!in)
+            return true;
+
+        // bytes of the current game's header read so far. once it's complete, moves are read up to an end marker
+        const int header_size = 14;
+        int header_pos = 0;
+        std::vector<char> buf(1 << 16);
+        while(in.read(buf.data(), buf.size()) || in.gcount() > 0)
+        {
+            for(std::streamsize i = 0; i < in.gcount(); ++i)
+            {
+                if(header_pos < header_size)
+                {
+                    // check the magic, so we never add to something that isn't a record
+                    if((header_pos == 0 && buf[i] != 'M') || (header_pos == 1 && buf[i] != 'G'))
+                        return false;
+                    ++header_pos;
+                }
+                else if((unsigned char)buf[i] == end_of_game)
+                    header_pos = 0;
+            }
+        }
+        if(in.bad())
+            return false;
+        in.close();
+
+        if(header_pos == 0)
+            return true;
+        if(header_pos < header_size)
+            return false;
+
+        std::ofstream out(path.c_str(), std::ios::binary | std::ios::app);
+        out.put(end_of_game);
+        return bool(out.flush());
+    }
+
+    Record_reader::Record_reader(std::istream & In):
+        in(In),
+        buf(1 << 16),
+        buf_pos(0),
+        buf_end(0)
+    {}
+
+    // make sure the buffer has data. returns false at end of stream
+    bool Record_reader::fill()
+    {
+        if(buf_pos < buf_end)
+            return true;
+        in.read(buf.data(), buf.size());
+        buf_pos = 0;
+        buf_end = in.gcount();
+        return buf_end > 0;
+    }
+
+    // next byte. throws on end of stream
+    unsigned char Record_reader::get_byte()
+    {
+        if(!fill())
+            throw std::runtime_error("unexpected end of game record");
+        return buf[buf_pos++];
+    }
+
+    // read the next game into rec, reusing its storage
+    // returns false at the end of the stream. throws std::runtime_error on malformed data
+    bool Record_reader::next(Game_record & rec)
+    {
+        if(!fill())
+            return false;
+
+        unsigned char raw[14];
+        for(auto & i: raw)
+            i = get_byte();
+
+        if(raw[0] != 'M' || raw[1] != 'G')
+            throw std::runtime_error("bad game record header");
+        if(raw[2] != record_version)
+            throw std::runtime_error("unsupported game record version");
+
+        rec.header.extra_rule = raw[3] & 1;
+        rec.header.capture_rule = raw[3] & 2;
+        rec.header.collect_rule = raw[3] & 4;
+        rec.header.num_bowls = raw[4];
+        rec.header.num_beads = raw[5];
+        rec.header.seed = 0;
+        for(int i = 0; i < 8; ++i)
+            rec.header.seed |= (std::uint64_t)raw[6 + i] << (8 * i);
+
+        // copy moves a buffer at a time, up to the end marker
+        rec.moves.clear();
+        while(true)
+        {
+            if(!fill())
+                throw std::runtime_error("unexpected end of game record");
+
+            const char * start = buf.data() + buf_pos;
+            const char * end = (const char *)std::memchr(start, end_of_game, buf_end - buf_pos);
+            if(end)
+            {
+                rec.moves.insert(rec.moves.end(), start, end);
+                buf_pos += end - start + 1;
+                break;
+            }
+            rec.moves.insert(rec.moves.end(), start, (const char *)buf.data() + buf_end);
+            buf_pos = buf_end;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,101 @@
+// record.h
+// compact binary game records
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_RECORD_H
+#define MANCALA_RECORD_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+// Record format. A file is any number of games back-to-back:
+//   'M' 'G'        magic
+//   version        1 byte, currently 1
+//   rules          1 byte: bit 0 extra move, bit 1 capture, bit 2 collect
+//   num_bowls      1 byte, < 127
+//   num_beads      1 byte
+//   seed           8 bytes, little-endian
+//   moves          1 byte each: bowl index, with the high bit set for player 2
+//   end            0xFF
+// the writer flushes after every move. a game cut off part way, as when the program is killed, has no end
+// marker, so end_partial_game must be used on a file before appending to it
+
+namespace Mancala
+{
+    // rules and setup for a recorded game
+    struct Game_header
+    {
+        int num_bowls, num_beads;
+        bool extra_rule, capture_rule, collect_rule;
+        std::uint64_t seed;
+    };
+
+    // a recorded game
+    struct Game_record
+    {
+        Game_header header;
+        // encoded moves. see encode_move / move_player / move_bowl
+        std::vector<unsigned char> moves;
+    };
+
+    // convert between moves and their byte encoding
+    unsigned char encode_move(const Player p, const int i);
+    inline Player move_player(const unsigned char m) { return (m & 0x80)? PLAYER_2: PLAYER_1; }
+    inline int move_bowl(const unsigned char m) { return m & 0x7F; }
+
+    // header for a game played on the given board
+    Game_header board_header(const Board & b);
+
+    // appends games to a stream
+    class Record_writer
+    {
+    public:
+        Record_writer(std::ostream & Out);
+        // ends any game in progress
+        ~Record_writer();
+
+        // start a new game, ending any game in progress
+        void begin_game(const Game_header & header);
+        // append a move to the game in progress, and flush it to the stream
+        void add_move(const Player p, const int i);
+        // end the game in progress, and flush it to the stream
+        void end_game();
+
+    private:
+        std::ostream & out;
+        bool in_game;
+    };
+
+    // add the end marker to a game left unfinished at the end of a record file, so more games can be appended
+    // returns true if the file is missing, or ends with a complete game or is fixed
+    // returns false if it can't be read or written, or ends part way through a header
+    bool end_partial_game(const std::string & path);
+
+    // reads games from a stream, one at a time, with buffered reads
+    class Record_reader
+    {
+    public:
+        Record_reader(std::istream & In);
+
+        // read the next game into rec, reusing its storage
+        // returns false at the end of the stream. throws std::runtime_error on malformed data
+        bool next(Game_record & rec);
+
+    private:
+        // make sure the buffer has data. returns false at end of stream
+        bool fill();
+        // next byte. throws on end of stream
+        unsigned char get_byte();
+
+        std::istream & in;
+        std::vector<char> buf;
+        size_t buf_pos, buf_end;
+    };
+}
+
+#endif // MANCALA_RECORD_H
@@ -0,0 +1,76 @@
+// rng.cpp
+// fast, seedable random number generator
+// Copyright Matthew Chandler 2014
+
+#include <chrono>
+
+#include "rng.h"
+
+// rotate left
+static inline std::uint64_t rotl(const std::uint64_t x, const int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+namespace Mancala
+{
+    Rng::Rng(const std::uint64_t Seed)
+    {
+        seed(Seed);
+    }
+
+    // reset the generator. the same seed always gives the same sequence
+    void Rng::seed(const std::uint64_t Seed)
+    {
+        // expand the seed with splitmix64, as recommended for xoshiro
+        std::uint64_t x = Seed;
+        for(auto & i: state)
+        {
+            x += 0x9e3779b97f4a7c15ULL;
+            i = splitmix64(x);
+        }
+    }
+
+    // next raw 64 bit value
+    std::uint64_t Rng::next()
+    {
+        const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const std::uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+
+        return result;
+    }
+
+    // random double in [0, 1)
+    double Rng::uniform()
+    {
+        // top 53 bits fill the mantissa
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // random int in [0, n)
+    int Rng::below(const int n)
+    {
+        return (int)(((next() >> 32) * (std::uint64_t)n) >> 32);
+    }
+
+    // mix a 64 bit value. used to expand seeds and to combine hashes
+    std::uint64_t splitmix64(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // a seed from the clock, for when reproducibility isn't needed
+    std::uint64_t random_seed()
+    {
+        return splitmix64(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    }
+}
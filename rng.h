@@ -0,0 +1,40 @@
+// rng.h
+// fast, seedable random number generator
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_RNG_H
+#define MANCALA_RNG_H
+
+#include <cstdint>
+
+namespace Mancala
+{
+    // xoshiro256** generator
+    // not thread safe: each thread / game should own its own generator
+    class Rng
+    {
+    public:
+        explicit Rng(const std::uint64_t Seed = 0);
+
+        // reset the generator. the same seed always gives the same sequence
+        void seed(const std::uint64_t Seed);
+
+        // next raw 64 bit value
+        std::uint64_t next();
+        // random double in [0, 1)
+        double uniform();
+        // random int in [0, n)
+        int below(const int n);
+
+    private:
+        std::uint64_t state[4];
+    };
+
+    // mix a 64 bit value. used to expand seeds and to combine hashes
+    std::uint64_t splitmix64(std::uint64_t x);
+
+    // a seed from the clock, for when reproducibility isn't needed
+    std::uint64_t random_seed();
+}
+
+#endif // MANCALA_RNG_H
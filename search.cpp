@@ -0,0 +1,593 @@
+// search.cpp
+// fast board representation and AI search
+// Copyright Matthew Chandler 2014
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+#include "search.h"
+#include "fixed_board.h"
+#include "trace.h"
+
+namespace Mancala
+{
+    // empty board
+    Simple_board::Simple_board(const int Num_bowls, const bool Extra_rule, const bool Capture_rule,
+        const bool Collect_rule):
+        num_bowls(Num_bowls), bowls(2 * Num_bowls + 2),
+        extra_rule(Extra_rule), capture_rule(Capture_rule), collect_rule(Collect_rule)
+    {
+        // set indexes
+        for(int i = 0; i < num_bowls; ++i)
+        {
+            bowls[i].across_i = 2 * num_bowls - i;
+            bowls[2 * num_bowls - i].across_i = i;
+        }
+
+        for(size_t i = 0; i < bowls.size(); ++i)
+            bowls[i].count = 0;
+        totals[PLAYER_1] = totals[PLAYER_2] = 0;
+
+        for(size_t i = 0; i < bowls.size() - 1; ++i)
+            bowls[i].next_i = i + 1;
+
+        bowls[2 * num_bowls + 1].next_i = 0;
+    }
+
+    // copy of a full board's counts and rules
+    Simple_board::Simple_board(const Mancala::Board & b):
+        Simple_board(b.num_bowls, b.extra_rule, b.capture_rule, b.collect_rule)
+    {
+        // copy bead counts from Board obj
+        for(int i = 0; i < num_bowls; ++i)
+        {
+            set_bowl(PLAYER_1, i, b.bottom_row[i].beads.size());
+            set_bowl(PLAYER_2, i, b.top_row[i].beads.size());
+        }
+
+        bowls[num_bowls].count = b.r_store.beads.size();
+        bowls[2 * num_bowls + 1].count = b.l_store.beads.size();
+    }
+
+    // perform a move
+    // returns true if the move earns an extra turn
+    bool Simple_board::move(const Mancala::Player p, const int i)
+    {
+        bool extra_move = false;
+        // get important indexes
+        int curr = (p == Mancala::PLAYER_1)? i: 2 * num_bowls - i;
+        int store = (p == Mancala::PLAYER_1)? num_bowls: 2 * num_bowls + 1;
+        int wrong_store = (p == Mancala::PLAYER_1)? 2 * num_bowls + 1: num_bowls;
+
+        // take beads from start and put into hand
+        int hand = bowls[curr].count;
+        bowls[curr].count = 0;
+        totals[p] -= hand;
+
+        // place each bead from the starting bowl
+        while(hand > 0)
+        {
+            curr = bowls[curr].next_i;
+            // skip opponent's store
+            if(curr == wrong_store)
+                curr = bowls[curr].next_i;
+            ++bowls[curr].count;
+            // player 2's bowls follow the r_store
+            if(curr != store)
+                ++totals[curr > num_bowls];
+            --hand;
+        }
+
+        // extra move when ending in our store
+        if(extra_rule && curr == store)
+            extra_move = true;
+
+        else if(capture_rule)
+        {
+            // collect last bead, and all beads across from it if we land in an empty bowl
+            // stores have nothing across from them
+            int across = bowls[curr].across_i;
+            if(curr != store && bowls[curr].count == 1 && bowls[across].count > 0)
+            {
+                totals[curr > num_bowls] -= 1;
+                totals[across > num_bowls] -= bowls[across].count;
+                bowls[store].count += bowls[across].count + 1;
+                bowls[curr].count = 0;
+                bowls[across].count = 0;
+            }
+        }
+
+        // when one side is empty, move all beads on the other side to that player's store
+        if(collect_rule)
+        {
+            if(totals[PLAYER_1] == 0 && totals[PLAYER_2] != 0)
+            {
+                for(int i = num_bowls + 1; i < 2 * num_bowls + 1; ++i)
+                    bowls[i].count = 0;
+                bowls[2 * num_bowls + 1].count += totals[PLAYER_2];
+                totals[PLAYER_2] = 0;
+            }
+            else if(totals[PLAYER_2] == 0 && totals[PLAYER_1] != 0)
+            {
+                for(int i = 0; i < num_bowls; ++i)
+                    bowls[i].count = 0;
+                bowls[num_bowls].count += totals[PLAYER_1];
+                totals[PLAYER_1] = 0;
+            }
+        }
+
+        return extra_move;
+    }
+
+    // is the game over
+    bool Simple_board::finished() const
+    {
+        return totals[PLAYER_1] == 0 || totals[PLAYER_2] == 0;
+    }
+
+    // bowl / store for each player, indexed as in Board's bottom_row / top_row
+    int Simple_board::bowl(const Mancala::Player p, const int i) const
+    {
+        return bowls[(p == Mancala::PLAYER_1)? i: 2 * num_bowls - i].count;
+    }
+    int & Simple_board::store(const Mancala::Player p)
+    {
+        return bowls[(p == Mancala::PLAYER_1)? num_bowls: 2 * num_bowls + 1].count;
+    }
+    int Simple_board::store(const Mancala::Player p) const
+    {
+        return bowls[(p == Mancala::PLAYER_1)? num_bowls: 2 * num_bowls + 1].count;
+    }
+
+    // set a bowl's count, keeping totals up to date
+    void Simple_board::set_bowl(const Mancala::Player p, const int i, const int count)
+    {
+        int & bowl = bowls[(p == Mancala::PLAYER_1)? i: 2 * num_bowls - i].count;
+        totals[p] += count - bowl;
+        bowl = count;
+    }
+
+    // heuristics to evaluate the board status for player 1
+    // the negative of the score for player 2, so the search can evaluate either side the same way
+    int Simple_board::evaluate() const
+    {
+        // with the collect rule, each side's remaining beads go to its owner at the end
+        int board_count = 0;
+        if(collect_rule)
+            board_count = totals[PLAYER_1] - totals[PLAYER_2];
+
+        return bowls[num_bowls].count - bowls.back().count + board_count;
+    }
+
+    // swap the players' sides, so player 2's position is seen as player 1's
+    void Simple_board::swap_sides()
+    {
+        // each half is a side's bowls followed by its store
+        for(int i = 0; i <= num_bowls; ++i)
+            std::swap(bowls[i].count, bowls[i + num_bowls + 1].count);
+        std::swap(totals[PLAYER_1], totals[PLAYER_2]);
+    }
+
+    // swap_move a list of moves, keeping it lowest first
+    void swap_moves(std::vector<int> & moves, const int num_bowls)
+    {
+        for(auto & i: moves)
+            i = swap_move(i, num_bowls);
+        std::reverse(moves.begin(), moves.end());
+    }
+
+    Search_limits::Search_limits(const int Depth, const int Movetime_ms, const std::atomic<bool> * Stop):
+        depth(Depth), movetime_ms(Movetime_ms), stop(Stop), max_extensions(MAX_EXTENSIONS),
+        reductions(REDUCTIONS), generic(false)
+    {}
+
+    // state shared through one search
+    struct Search_ctx
+    {
+        unsigned long long nodes;
+        const std::atomic<bool> * stop;
+        bool has_deadline;
+        std::chrono::steady_clock::time_point deadline;
+        // set once the search runs out of time or is stopped. results after this are discarded
+        bool aborted;
+        // the first iteration is never aborted, so there's always a move
+        bool can_abort;
+        // from Search_limits
+        int max_extensions;
+        bool reductions;
+    };
+
+    // late move reductions: moves after this many at a node are searched less deeply
+    const int LMR_MIN_MOVES = 3;
+    // only reduce with at least this much look-ahead left
+    const int LMR_MIN_DEPTH = 3;
+
+    // check the stop flag and clock every this many nodes
+    const unsigned long long CHECK_INTERVAL = 1024;
+
+    // count a node, and check if we need to stop
+    inline bool check_abort(Search_ctx & ctx)
+    {
+        if(++ctx.nodes % CHECK_INTERVAL == 0 && ctx.can_abort)
+        {
+            if((ctx.stop && ctx.stop->load(std::memory_order_relaxed))
+                || (ctx.has_deadline && std::chrono::steady_clock::now() >= ctx.deadline))
+                ctx.aborted = true;
+        }
+        return ctx.aborted;
+    }
+
+    // helper recursive function for search
+    // always searches for player 1, so the position is swapped to the other side after each turn.
+    // scores are for the player to move
+    // extensions is how many more plies this line may search without using up depth
+    // Board_type is Simple_board, or a Fixed_board for sizes known at compile time
+    template<typename Board_type>
+    int negamax(Search_ctx & ctx, const Board_type & b, const int depth, const int extensions, int alpha,
+        const int beta)
+    {
+        if(check_abort(ctx))
+            return 0;
+        if(depth == 0)
+            return b.evaluate();
+        // move toward closest win, avoid loss as long as possible
+        if(b.finished())
+        {
+            int diff = b.evaluate();
+            if(diff == 0)
+                return 0;
+            else if(diff > 0)
+                return 1000 + diff + depth;
+            else
+                return -1000 + diff - depth;
+        }
+
+        // with only one move, there's nothing to choose, so it's extended
+        bool forced = false;
+        if(extensions > 0)
+        {
+            int num_moves = 0;
+            for(int i = 0; i < b.num_bowls && num_moves < 2; ++i)
+                if(b.bowl(Mancala::PLAYER_1, i) > 0)
+                    ++num_moves;
+            forced = num_moves == 1;
+        }
+
+        // recursively try each possible move. moves that earn an extra turn first, then the rest
+        int searched = 0;
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            for(int i = 0; i < b.num_bowls; ++i)
+            {
+                int count = b.bowl(Mancala::PLAYER_1, i);
+                if(count == 0)
+                    continue;
+                // the last bead lands in our store
+                bool extra_turn = b.extra_rule && count % (2 * b.num_bowls + 1) == b.num_bowls - i;
+                if(extra_turn != (pass == 0))
+                    continue;
+                // extra turns and forced moves don't use up depth, while extensions are left
+                int sub_depth = depth - 1, sub_extensions = extensions;
+                if((extra_turn || forced) && extensions > 0)
+                {
+                    sub_depth = depth;
+                    --sub_extensions;
+                }
+
+                Board_type sub_b = b;
+                int score = 0;
+                if(sub_b.move(Mancala::PLAYER_1, i)) // do we get another move?
+                    score = negamax(ctx, sub_b, sub_depth, sub_extensions, alpha, beta);
+                else
+                {
+                    sub_b.swap_sides();
+                    // late moves get one less ply. if that looks better than the best so far, search again fully
+                    if(ctx.reductions && searched >= LMR_MIN_MOVES && depth >= LMR_MIN_DEPTH)
+                    {
+                        score = -negamax(ctx, sub_b, sub_depth - 1, sub_extensions, -alpha - 1, -alpha);
+                        if(!ctx.aborted && score > alpha)
+                            score = -negamax(ctx, sub_b, sub_depth, sub_extensions, -beta, -alpha);
+                    }
+                    else
+                        score = -negamax(ctx, sub_b, sub_depth, sub_extensions, -beta, -alpha);
+                }
+                ++searched;
+                if(ctx.aborted)
+                    return 0;
+                if(score >= beta)
+                    return beta;
+                if(score > alpha)
+                    alpha = score;
+            }
+        }
+        return alpha;
+    }
+
+    // score every move for player 1 at the given depth
+    // returns false if aborted, leaving result untouched
+    template<typename Board_type>
+    bool search_depth(Search_ctx & ctx, const Board_type & b, const int depth, Search_result & result)
+    {
+        // bounds wide enough for any score, that can be safely negated
+        const int inf = std::numeric_limits<int>::max();
+        int best = -inf;
+        std::vector<int> best_i;
+
+        // loop over available moves
+        for(int i = 0; i < b.num_bowls; ++i)
+        {
+            if(b.bowl(PLAYER_1, i) == 0)
+                continue;
+            Trace_span span("root move", "move", i);
+            // try each move
+            Board_type sub_b = b;
+            int score = 0;
+            if(sub_b.move(PLAYER_1, i))
+                score = negamax(ctx, sub_b, depth, ctx.max_extensions, -inf, inf);
+            else
+            {
+                sub_b.swap_sides();
+                score = -negamax(ctx, sub_b, depth, ctx.max_extensions, -inf, inf);
+            }
+            if(ctx.aborted)
+                return false;
+            // keep track of the move(s) with the best score
+            if(score > best)
+            {
+                best = score;
+                best_i.clear();
+                best_i.push_back(i);
+            }
+            else if(score == best)
+                best_i.push_back(i);
+        }
+
+        result.moves = best_i;
+        result.score = best;
+        result.depth = depth;
+        return true;
+    }
+
+    // find the best move(s) for player 1, with the board size known at compile time if Board_type is a Fixed_board
+    template<typename Board_type>
+    Search_result search_board(const Board_type & b, const Search_limits & limits)
+    {
+        Trace_span span("search", "depth", limits.depth);
+        Search_ctx ctx;
+        ctx.nodes = 0;
+        ctx.stop = limits.stop;
+        ctx.has_deadline = limits.movetime_ms > 0;
+        ctx.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.movetime_ms);
+        ctx.aborted = false;
+        ctx.can_abort = false;
+        ctx.max_extensions = limits.max_extensions;
+        ctx.reductions = limits.reductions;
+
+        Search_result result;
+        result.score = 0;
+        result.depth = -1;
+
+        if(!ctx.has_deadline && !ctx.stop)
+        {
+            // no way to stop early, so go straight to full depth
+            search_depth(ctx, b, limits.depth, result);
+        }
+        else
+        {
+            // deepen one step at a time, keeping the deepest completed result
+            for(int depth = 0; depth <= limits.depth; ++depth)
+            {
+                if(!search_depth(ctx, b, depth, result))
+                    break;
+                // nothing to search
+                if(result.moves.empty())
+                    break;
+                ctx.can_abort = true;
+                if(limits.on_depth)
+                {
+                    result.nodes = ctx.nodes;
+                    limits.on_depth(result);
+                }
+            }
+        }
+
+        result.nodes = ctx.nodes;
+        return result;
+    }
+
+    // find the best move(s) for p
+    Search_result search(const Simple_board & b, const Mancala::Player p, const Search_limits & limits)
+    {
+        if(p == PLAYER_2)
+        {
+            // search player 2's position from player 1's side, and swap the moves back
+            Simple_board swapped = b;
+            swapped.swap_sides();
+            Search_limits swapped_limits = limits;
+            if(limits.on_depth)
+            {
+                swapped_limits.on_depth = [&limits, &b](const Search_result & result)
+                {
+                    Search_result swapped_result = result;
+                    swap_moves(swapped_result.moves, b.num_bowls);
+                    limits.on_depth(swapped_result);
+                };
+            }
+            Search_result result = search(swapped, PLAYER_1, swapped_limits);
+            swap_moves(result.moves, b.num_bowls);
+            return result;
+        }
+
+        if(!limits.generic)
+        {
+            // common sizes get their own kernel
+            switch(b.num_bowls)
+            {
+            case 4:
+                return search_board(Fixed_board<4>(b), limits);
+            case 5:
+                return search_board(Fixed_board<5>(b), limits);
+            case 6:
+                return search_board(Fixed_board<6>(b), limits);
+            case 7:
+                return search_board(Fixed_board<7>(b), limits);
+            case 8:
+                return search_board(Fixed_board<8>(b), limits);
+            }
+        }
+        return search_board(b, limits);
+    }
+
+    // predicted time for one search at the given look-ahead, in seconds
+    double Search_cost::predict(const int depth) const
+    {
+        return nodes * std::pow(branching, depth - this->depth) / nodes_per_sec;
+    }
+
+    // deepest look-ahead predicted to take no more than secs, up to max_depth
+    int Search_cost::deepest_within(const double secs, const int max_depth) const
+    {
+        int best = 0;
+        for(int d = 0; d <= max_depth; ++d)
+            if(predict(d) <= secs)
+                best = d;
+        return best;
+    }
+
+    // measure search cost on this machine for a board size and rules
+    Search_cost calibrate(const int num_bowls, const int num_beads, const bool extra_rule, const bool capture_rule,
+        const bool collect_rule, const int budget_ms, const std::atomic<bool> * stop)
+    {
+        // sample positions: the start of the game, and a few random moves in
+        // always the same positions for a given board, so the results are comparable
+        Simple_board start(num_bowls, extra_rule, capture_rule, collect_rule);
+        for(int i = 0; i < num_bowls; ++i)
+        {
+            start.set_bowl(PLAYER_1, i, num_beads);
+            start.set_bowl(PLAYER_2, i, num_beads);
+        }
+        std::vector<std::pair<Simple_board, Player>> samples;
+        Rng rng(splitmix64(num_bowls << 16 | num_beads));
+        for(int plies = 0; plies <= 6; plies += 2)
+        {
+            Simple_board b = start;
+            Player p = PLAYER_1;
+            for(int ply = 0; ply < plies && !b.finished(); ++ply)
+            {
+                int i;
+                do
+                    i = rng.below(num_bowls);
+                while(b.bowl(p, i) == 0);
+                if(!b.move(p, i))
+                    p = (p == PLAYER_1)? PLAYER_2: PLAYER_1;
+            }
+            if(!b.finished())
+                samples.push_back(std::make_pair(b, p));
+        }
+        if(samples.empty())
+            samples.push_back(std::make_pair(start, PLAYER_1));
+
+        Search_cost cost;
+        cost.branching = 1.0;
+        cost.depth = 0;
+        cost.nodes = 1.0;
+        cost.nodes_per_sec = 1.0;
+
+        auto start_time = std::chrono::steady_clock::now();
+        double budget = budget_ms / 1000.0;
+        double total_nodes = 0.0, total_secs = 0.0;
+        std::vector<double> nodes_at;
+
+        // deepen until the next depth is predicted to run over budget
+        for(int depth = 0; depth < 64; ++depth)
+        {
+            double nodes = 0.0;
+            auto depth_start = std::chrono::steady_clock::now();
+            for(auto & sample: samples)
+            {
+                if(stop && *stop)
+                    return cost;
+                nodes += search(sample.first, sample.second, Search_limits(depth)).nodes;
+            }
+            auto now = std::chrono::steady_clock::now();
+            total_nodes += nodes;
+            total_secs += std::chrono::duration<double>(now - depth_start).count();
+            nodes_at.push_back(nodes / samples.size());
+
+            cost.depth = depth;
+            cost.nodes = nodes_at.back();
+            // nodes alternate between odd and even depths, so measure growth over 2 steps when we can
+            if(depth >= 2)
+                cost.branching = std::sqrt(nodes_at[depth] / nodes_at[depth - 2]);
+            else if(depth == 1)
+                cost.branching = nodes_at[1] / nodes_at[0];
+            cost.branching = std::max(cost.branching, 1.0);
+            if(total_secs > 0.0)
+                cost.nodes_per_sec = total_nodes / total_secs;
+
+            // the whole game tree has been searched
+            if(depth >= 2 && nodes_at[depth] <= nodes_at[depth - 2])
+                break;
+
+            double elapsed = std::chrono::duration<double>(now - start_time).count();
+            if(elapsed + cost.predict(depth + 1) * samples.size() > budget)
+                break;
+        }
+
+        return cost;
+    }
+
+    // parse a position from text
+    std::string parse_position(const std::string & text, Simple_board & b, Mancala::Player & p)
+    {
+        std::istringstream in(text);
+        int side;
+        std::string rules;
+        if(!(in>>side>>rules) || (side != 1 && side != 2))
+            return "expected side (1 or 2) and rules";
+        bool extra_rule, capture_rule, collect_rule;
+        if(!parse_rules(rules, extra_rule, capture_rule, collect_rule))
+            return "unknown rule in '" + rules + "'";
+
+        std::vector<int> counts;
+        int count;
+        while(in>>count)
+        {
+            if(count < 0)
+                return "negative count";
+            counts.push_back(count);
+        }
+        if(!in.eof())
+            return "expected a count";
+        if(counts.size() < 4 || counts.size() % 2 != 0)
+            return "expected 2 stores and the same number of bowls for each player";
+
+        int num_bowls = (counts.size() - 2) / 2;
+        b = Simple_board(num_bowls, extra_rule, capture_rule, collect_rule);
+        p = (side == 1)? PLAYER_1: PLAYER_2;
+
+        b.store(PLAYER_1) = counts[0];
+        b.store(PLAYER_2) = counts[1];
+        for(int i = 0; i < num_bowls; ++i)
+        {
+            b.set_bowl(PLAYER_1, i, counts[2 + i]);
+            b.set_bowl(PLAYER_2, i, counts[2 + num_bowls + i]);
+        }
+        return "";
+    }
+
+    // parse a rules string, as used in parse_position
+    bool parse_rules(const std::string & rules, bool & extra_rule, bool & capture_rule, bool & collect_rule)
+    {
+        if(rules.empty() || rules.find_first_not_of("ecl-") != std::string::npos)
+            return false;
+        extra_rule = rules.find('e') != std::string::npos;
+        capture_rule = rules.find('c') != std::string::npos;
+        collect_rule = rules.find('l') != std::string::npos;
+        return true;
+    }
+}
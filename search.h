@@ -0,0 +1,145 @@
+// search.h
+// fast board representation and AI search
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_SEARCH_H
+#define MANCALA_SEARCH_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+namespace Mancala
+{
+    // simple bowl and board classes to speed up ai search
+    struct Simple_bowl
+    {
+        int count;
+        // indexes to other bowls.
+        // using indexes instead of pointers to allow fast copying
+        int next_i;
+        int across_i;
+    };
+
+    class Simple_board
+    {
+    public:
+        // empty board
+        Simple_board(const int Num_bowls = 6, const bool Extra_rule = true, const bool Capture_rule = true,
+            const bool Collect_rule = true);
+        // copy of a full board's counts and rules
+        Simple_board(const Mancala::Board & b);
+
+        // perform a move
+        // returns true if the move earns an extra turn
+        bool move(const Mancala::Player p, const int i);
+        // is the game over
+        bool finished() const;
+        // heuristics to evaluate the board status for player 1
+        int evaluate() const;
+        // swap the players' sides, so player 2's position is seen as player 1's. see swap_move
+        void swap_sides();
+
+        // bowl / store for each player, indexed as in Board's bottom_row / top_row
+        int bowl(const Mancala::Player p, const int i) const;
+        int & store(const Mancala::Player p);
+        int store(const Mancala::Player p) const;
+        // set a bowl's count, keeping totals up to date
+        void set_bowl(const Mancala::Player p, const int i, const int count);
+
+        // board layout: <bottom row><r_store><top_row><l_store>
+        int num_bowls;
+        std::vector<Simple_bowl> bowls;
+        // beads in each player's bowls, not counting stores. indexed by Player
+        int totals[2];
+        bool extra_rule, capture_rule, collect_rule;
+    };
+
+    struct Search_result
+    {
+        // all moves sharing the best score, lowest first. empty if p has no moves
+        std::vector<int> moves;
+        // score of the best move(s) for the player to move
+        int score;
+        // deepest look-ahead completed
+        int depth;
+        // positions visited
+        unsigned long long nodes;
+    };
+
+    // default selective search settings. see Search_limits
+    // in self-play, reductions alone match plain search's strength with 20-30% fewer nodes. extensions
+    // roughly doubled the nodes at a given depth with no measurable gain, so are off
+    const int MAX_EXTENSIONS = 0;
+    const bool REDUCTIONS = true;
+
+    // limits for search()
+    struct Search_limits
+    {
+        Search_limits(const int Depth = 10, const int Movetime_ms = 0, const std::atomic<bool> * Stop = NULL);
+
+        // how far to look ahead after the first move
+        int depth;
+        // time budget, in ms. 0 for no limit
+        // when set, search deepens one step at a time until depth is reached or time runs out
+        int movetime_ms;
+        // when set to true by another thread, search returns the deepest completed result
+        const std::atomic<bool> * stop;
+        // when set, called with each completed depth while deepening
+        std::function<void(const Search_result &)> on_depth;
+        // extra plies any one line may search for moves that earn an extra turn, and forced moves
+        int max_extensions;
+        // search moves late in the move order one ply less, re-searching any that beat the best so far
+        bool reductions;
+        // always use the Simple_board search, even for sizes with their own kernel. for benchmarking
+        bool generic;
+    };
+
+    // find the best move(s) for p
+    // player 2's positions are searched as player 1's after swap_sides, so both share one search
+    Search_result search(const Simple_board & b, const Mancala::Player p, const Search_limits & limits);
+
+    // a move before and after swap_sides: player 2's bowl i is player 1's bowl num_bowls - 1 - i, and back
+    inline int swap_move(const int i, const int num_bowls)
+    {
+        return num_bowls - 1 - i;
+    }
+    // swap_move a list of moves, keeping it lowest first
+    void swap_moves(std::vector<int> & moves, const int num_bowls);
+
+    // measured cost of searching, for predicting how long a search will take
+    struct Search_cost
+    {
+        // positions searched per second
+        double nodes_per_sec;
+        // effective branching factor: how many times more positions each extra step of look-ahead visits
+        double branching;
+        // deepest look-ahead measured, and the average positions visited by one search at that depth
+        int depth;
+        double nodes;
+
+        // predicted time for one search at the given look-ahead, in seconds
+        double predict(const int depth) const;
+        // deepest look-ahead predicted to take no more than secs, up to max_depth
+        int deepest_within(const double secs, const int max_depth) const;
+    };
+
+    // measure search cost on this machine for a board size and rules, taking about budget_ms
+    // searches sample positions from the start of a game at increasing look-ahead
+    // stops early if stop is set to true by another thread
+    Search_cost calibrate(const int num_bowls, const int num_beads, const bool extra_rule, const bool capture_rule,
+        const bool collect_rule, const int budget_ms, const std::atomic<bool> * stop = NULL);
+
+    // parse a position from text:
+    //   <side> <rules> <p1 store> <p2 store> <p1 bowls...> <p2 bowls...>
+    // side is 1 or 2, rules is any of e (extra move), c (capture), l (collect) or - for none
+    // returns an error message, or "" on success
+    std::string parse_position(const std::string & text, Simple_board & b, Mancala::Player & p);
+    // parse a rules string, as used in parse_position. returns false if it's invalid
+    bool parse_rules(const std::string & rules, bool & extra_rule, bool & capture_rule, bool & collect_rule);
+}
+
+#endif // MANCALA_SEARCH_H
@@ -0,0 +1,418 @@
+// solver.cpp
+// exact game solver for small boards
+// Copyright Matthew Chandler 2014
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "rng.h"
+#include "solver.h"
+#include "trace.h"
+
+namespace Mancala
+{
+    // table data layout
+    // bits 0-15: value, offset to be positive
+    // bits 16-17: bound type
+    // bits 18-25: best move, or NO_MOVE
+    // bit 63: set for any stored entry, so an empty entry never matches
+    const int VALUE_OFFSET = 1 << 15;
+    enum Bound {BOUND_EXACT = 1, BOUND_LOWER = 2, BOUND_UPPER = 3};
+    const int NO_MOVE = 0xFF;
+    const std::uint64_t VALID_BIT = (std::uint64_t)1 << 63;
+
+    std::uint64_t pack(const int value, const Bound bound, const int move)
+    {
+        return VALID_BIT | (std::uint64_t)(value + VALUE_OFFSET) | (std::uint64_t)bound << 16
+            | (std::uint64_t)(move & 0xFF) << 18;
+    }
+    int unpack_value(const std::uint64_t data) { return (int)(data & 0xFFFF) - VALUE_OFFSET; }
+    Bound unpack_bound(const std::uint64_t data) { return (Bound)(data >> 16 & 0x3); }
+    int unpack_move(const std::uint64_t data) { return data >> 18 & 0xFF; }
+
+    // check the stop flag every this many nodes
+    const unsigned long long SOLVE_CHECK_INTERVAL = 4096;
+
+    // hash of a position for player 1, including its size and rules
+    std::uint64_t hash_bottom(const Simple_board & b)
+    {
+        std::uint64_t hash = splitmix64((std::uint64_t)b.num_bowls << 8 | b.extra_rule << 3 | b.capture_rule << 2
+            | b.collect_rule << 1);
+        for(auto & bowl: b.bowls)
+            hash = splitmix64(hash ^ bowl.count);
+        return hash;
+    }
+
+    // hash of a position, including its size and rules
+    std::uint64_t position_hash(const Simple_board & b, const Mancala::Player p)
+    {
+        if(p == PLAYER_1)
+            return hash_bottom(b);
+        Simple_board swapped = b;
+        swapped.swap_sides();
+        return hash_bottom(swapped);
+    }
+
+    // per-thread search state
+    struct Solver::Thread_ctx
+    {
+        unsigned long long nodes;
+        const std::atomic<bool> * stop;
+        // set by any thread that sees stop, so all threads give up
+        std::atomic<bool> * aborted;
+    };
+
+    Solver::Solver(const size_t Table_mb, const int Threads):
+        checkpoint_secs(60),
+        num_threads((Threads > 0)? Threads: std::max(1u, std::thread::hardware_concurrency())),
+        last_checkpoint(std::chrono::steady_clock::now())
+    {
+        // largest power of 2 that fits
+        size_t num_entries = 1;
+        while(num_entries * 2 * sizeof(Entry) <= std::max(Table_mb, (size_t)1) << 20)
+            num_entries *= 2;
+
+        table = std::vector<Entry>(num_entries);
+        for(auto & entry: table)
+        {
+            entry.key.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+        mask = num_entries - 1;
+    }
+
+    // look up a position. returns false if it's not in the table
+    bool Solver::probe(const std::uint64_t hash, std::uint64_t & data) const
+    {
+        const Entry & entry = table[hash & mask];
+        std::uint64_t key = entry.key.load(std::memory_order_relaxed);
+        data = entry.data.load(std::memory_order_relaxed);
+        return (data & VALID_BIT) && (key ^ data) == hash;
+    }
+
+    void Solver::store(const std::uint64_t hash, const std::uint64_t data)
+    {
+        Entry & entry = table[hash & mask];
+        entry.key.store(hash ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+    // value of b for player 1, within alpha and beta
+    // positions are swapped after each turn, so player 1 is always to move
+    int Solver::negamax(Thread_ctx & ctx, const Simple_board & b, int alpha, int beta)
+    {
+        if(++ctx.nodes % SOLVE_CHECK_INTERVAL == 0 && ctx.stop && *ctx.stop)
+            *ctx.aborted = true;
+        if(*ctx.aborted)
+            return 0;
+
+        // game over: beads left on the board are collected by their owner, if that rule is on
+        if(b.finished())
+        {
+            int value = b.store(PLAYER_1) - b.store(PLAYER_2);
+            if(b.collect_rule)
+                value += b.totals[PLAYER_1] - b.totals[PLAYER_2];
+            return value;
+        }
+
+        std::uint64_t hash = hash_bottom(b);
+        std::uint64_t data;
+        int tt_move = NO_MOVE;
+        if(probe(hash, data))
+        {
+            int value = unpack_value(data);
+            Bound bound = unpack_bound(data);
+            if(bound == BOUND_EXACT
+                || (bound == BOUND_LOWER && value >= beta)
+                || (bound == BOUND_UPPER && value <= alpha))
+                return value;
+            tt_move = unpack_move(data);
+        }
+
+        // order moves: the table's best move, then moves that earn an extra turn, then the rest
+        int moves[256];
+        int num_moves = 0;
+        if(tt_move != NO_MOVE && tt_move < b.num_bowls && b.bowl(PLAYER_1, tt_move) > 0)
+            moves[num_moves++] = tt_move;
+        int num_ordered = num_moves;
+        for(int i = 0; i < b.num_bowls; ++i)
+        {
+            int count = b.bowl(PLAYER_1, i);
+            if(count == 0 || i == tt_move)
+                continue;
+            if(b.extra_rule && count % (2 * b.num_bowls + 1) == b.num_bowls - i)
+            {
+                moves[num_moves++] = moves[num_ordered];
+                moves[num_ordered++] = i;
+            }
+            else
+                moves[num_moves++] = i;
+        }
+
+        int orig_alpha = alpha;
+        int best = -VALUE_OFFSET, best_move = NO_MOVE;
+        for(int m = 0; m < num_moves; ++m)
+        {
+            Simple_board sub_b = b;
+            int value;
+            if(sub_b.move(PLAYER_1, moves[m]))
+                value = negamax(ctx, sub_b, alpha, beta);
+            else
+            {
+                sub_b.swap_sides();
+                value = -negamax(ctx, sub_b, -beta, -alpha);
+            }
+            if(*ctx.aborted)
+                return 0;
+
+            if(value > best)
+            {
+                best = value;
+                best_move = moves[m];
+            }
+            if(best > alpha)
+                alpha = best;
+            if(alpha >= beta)
+                break;
+        }
+
+        Bound bound = (best <= orig_alpha)? BOUND_UPPER: (best >= beta)? BOUND_LOWER: BOUND_EXACT;
+        store(hash, pack(best, bound, best_move));
+        return best;
+    }
+
+    // solve a position for p
+    Solve_result Solver::solve(const Simple_board & b, const Mancala::Player p, const std::atomic<bool> * stop)
+    {
+        // solve player 2's position from player 1's side, and swap the move back
+        if(p == PLAYER_2)
+        {
+            Simple_board swapped = b;
+            swapped.swap_sides();
+            Solve_result result = solve(swapped, PLAYER_1, stop);
+            if(result.move >= 0)
+                result.move = swap_move(result.move, b.num_bowls);
+            return result;
+        }
+
+        Solve_result result;
+        result.value = 0;
+        result.move = -1;
+        result.nodes = 0;
+        result.complete = true;
+
+        std::vector<int> root_moves;
+        for(int i = 0; i < b.num_bowls; ++i)
+            if(b.bowl(PLAYER_1, i) > 0)
+                root_moves.push_back(i);
+
+        if(b.num_bowls > SOLVER_MAX_BOWLS)
+        {
+            result.complete = false;
+            return result;
+        }
+
+        if(b.finished() || root_moves.empty())
+        {
+            Thread_ctx ctx;
+            std::atomic<bool> aborted(false);
+            ctx.nodes = 0;
+            ctx.stop = stop;
+            ctx.aborted = &aborted;
+            result.value = negamax(ctx, b, -VALUE_OFFSET, VALUE_OFFSET);
+            result.nodes = ctx.nodes;
+            return result;
+        }
+
+        // periodically save the table. the interval carries over between solves, so a run of short solves
+        // still checkpoints
+        std::mutex checkpoint_mutex;
+        std::condition_variable checkpoint_cv;
+        bool done = false;
+        std::thread checkpoint_thread;
+        if(!checkpoint_path.empty())
+        {
+            checkpoint_thread = std::thread([&]()
+            {
+                std::unique_lock<std::mutex> lock(checkpoint_mutex);
+                while(!checkpoint_cv.wait_until(lock, last_checkpoint + std::chrono::seconds(checkpoint_secs),
+                    [&]{ return done; }))
+                {
+                    save(checkpoint_path);
+                    last_checkpoint = std::chrono::steady_clock::now();
+                }
+            });
+        }
+
+        // split the root moves between threads. each thread takes the next unsearched move,
+        // and only needs to prove whether it beats the best found so far
+        std::mutex root_mutex;
+        size_t next_move = 0;
+        int best = -VALUE_OFFSET;
+        int best_move = -1;
+        std::atomic<bool> aborted(false);
+        std::atomic<unsigned long long> total_nodes(0);
+
+        auto worker = [&]()
+        {
+            Thread_ctx ctx;
+            ctx.nodes = 0;
+            ctx.stop = stop;
+            ctx.aborted = &aborted;
+            while(true)
+            {
+                int i, alpha;
+                {
+                    std::lock_guard<std::mutex> lock(root_mutex);
+                    if(next_move >= root_moves.size())
+                        break;
+                    i = root_moves[next_move++];
+                    alpha = best;
+                }
+
+                Trace_span span("solve root move", "move", i);
+                Simple_board sub_b = b;
+                int value;
+                if(sub_b.move(PLAYER_1, i))
+                    value = negamax(ctx, sub_b, alpha, VALUE_OFFSET);
+                else
+                {
+                    sub_b.swap_sides();
+                    value = -negamax(ctx, sub_b, -VALUE_OFFSET, -alpha);
+                }
+                if(aborted)
+                    break;
+
+                // a value at or below alpha is only an upper bound, but can't beat the best anyway
+                std::lock_guard<std::mutex> lock(root_mutex);
+                // ties go to the lowest move, so the result doesn't depend on thread timing
+                if(value > best || (value == best && value > alpha && i < best_move))
+                {
+                    best = value;
+                    best_move = i;
+                }
+            }
+            total_nodes += ctx.nodes;
+        };
+
+        std::vector<std::thread> threads;
+        for(int t = 1; t < std::min(num_threads, (int)root_moves.size()); ++t)
+            threads.push_back(std::thread(worker));
+        worker();
+        for(auto & thread: threads)
+            thread.join();
+
+        if(checkpoint_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(checkpoint_mutex);
+                done = true;
+            }
+            checkpoint_cv.notify_all();
+            checkpoint_thread.join();
+        }
+
+        result.value = best;
+        result.move = best_move;
+        result.nodes = total_nodes;
+        result.complete = !aborted;
+        return result;
+    }
+
+    // file layout: "MSL2", number of entries (8 bytes), then each entry's key and data (8 bytes each)
+    // all little-endian
+    // the last byte is the format version. tables from other versions hash positions differently
+    const char SOLVER_MAGIC[4] = {'M', 'S', 'L', '2'};
+
+    void write_u64(std::ostream & out, std::uint64_t x)
+    {
+        char buf[8];
+        for(int i = 0; i < 8; ++i)
+            buf[i] = (char)(x >> (8 * i));
+        out.write(buf, 8);
+    }
+
+    bool read_u64(std::istream & in, std::uint64_t & x)
+    {
+        unsigned char buf[8];
+        if(!in.read((char *)buf, 8))
+            return false;
+        x = 0;
+        for(int i = 0; i < 8; ++i)
+            x |= (std::uint64_t)buf[i] << (8 * i);
+        return true;
+    }
+
+    // save the table. written to a temporary file first, so an interrupted save leaves the last checkpoint intact
+    bool Solver::save(const std::string & path) const
+    {
+        std::string tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+            if(!out)
+                return false;
+
+            std::uint64_t count = 0;
+            for(auto & entry: table)
+                if(entry.data.load(std::memory_order_relaxed) & VALID_BIT)
+                    ++count;
+
+            out.write(SOLVER_MAGIC, sizeof(SOLVER_MAGIC));
+            write_u64(out, count);
+            // entries may change while saving. a torn entry fails the key check on load, and is dropped
+            for(auto & entry: table)
+            {
+                if(count == 0)
+                    break;
+                std::uint64_t key = entry.key.load(std::memory_order_relaxed);
+                std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+                if(!(data & VALID_BIT))
+                    continue;
+                write_u64(out, key);
+                write_u64(out, data);
+                --count;
+            }
+            // pad out entries that were cleared while saving
+            for(; count > 0; --count)
+            {
+                write_u64(out, 0);
+                write_u64(out, 0);
+            }
+            if(!out)
+                return false;
+        }
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    // load a saved table, adding its entries to this one
+    bool Solver::load(const std::string & path)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if(!in)
+            return false;
+
+        char magic[sizeof(SOLVER_MAGIC)];
+        std::uint64_t count;
+        if(!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), SOLVER_MAGIC)
+            || !read_u64(in, count))
+            return false;
+
+        for(std::uint64_t i = 0; i < count; ++i)
+        {
+            std::uint64_t key, data;
+            if(!read_u64(in, key) || !read_u64(in, data))
+                return false;
+            if(data & VALID_BIT)
+                store(key ^ data, data);
+        }
+        return true;
+    }
+}
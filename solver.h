@@ -0,0 +1,85 @@
+// solver.h
+// exact game solver for small boards
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_SOLVER_H
+#define MANCALA_SOLVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "search.h"
+
+namespace Mancala
+{
+    // largest board the solver handles
+    const int SOLVER_MAX_BOWLS = 255;
+
+    struct Solve_result
+    {
+        // final score difference (own store - opponent's) with perfect play by both sides
+        int value;
+        // a move that achieves value. -1 if there are no moves
+        // if stopped, the best of the root moves fully searched so far, or -1 if none were
+        int move;
+        // positions visited
+        unsigned long long nodes;
+        // false if stopped before the value was proven
+        bool complete;
+    };
+
+    // solves positions exactly by searching to the end of the game
+    // positions never repeat (every move either adds to a store or moves beads toward the mover's store),
+    // so an exhaustive depth-first search always ends
+    class Solver
+    {
+    public:
+        // Table_mb: size of the transposition table, in MB. rounded down to a power of 2 entries
+        // Threads: number of search threads. 0 for the number of CPUs
+        Solver(const size_t Table_mb = 256, const int Threads = 0);
+
+        // solve a position for p
+        // stops early if stop is set to true by another thread
+        Solve_result solve(const Simple_board & b, const Mancala::Player p, const std::atomic<bool> * stop = NULL);
+
+        // save / load the table. results from a saved table are reused, so an interrupted solve can resume
+        // load accepts a table of any size. returns false on failure
+        bool save(const std::string & path) const;
+        bool load(const std::string & path);
+
+        // if set, solve saves the table here every checkpoint_secs of solving
+        // loading it before the first solve, and saving after the last, is up to the caller
+        std::string checkpoint_path;
+        int checkpoint_secs;
+
+    private:
+        // table entry. key is stored xor'd with data, so a torn write from another thread never matches
+        struct Entry
+        {
+            std::atomic<std::uint64_t> key;
+            std::atomic<std::uint64_t> data;
+        };
+
+        // look up a position. returns false if it's not in the table
+        bool probe(const std::uint64_t hash, std::uint64_t & data) const;
+        void store(const std::uint64_t hash, const std::uint64_t data);
+
+        struct Thread_ctx;
+        int negamax(Thread_ctx & ctx, const Simple_board & b, int alpha, int beta);
+
+        std::vector<Entry> table;
+        std::uint64_t mask;
+        int num_threads;
+        // when the table was last saved to checkpoint_path, or the solver was created
+        std::chrono::steady_clock::time_point last_checkpoint;
+    };
+
+    // hash of a position, including its size and rules
+    // a position for player 2 hashes the same as its swap_sides for player 1, as they have the same value
+    std::uint64_t position_hash(const Simple_board & b, const Mancala::Player p);
+}
+
+#endif // MANCALA_SOLVER_H
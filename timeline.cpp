@@ -0,0 +1,40 @@
+// timeline.cpp
+// named timestamps for measuring startup time
+// Copyright Matthew Chandler 2014
+
+#include <iomanip>
+
+#include "timeline.h"
+
+namespace Mancala
+{
+    Timeline startup_timeline;
+
+    Timeline::Timeline():
+        enabled(false),
+        start(std::chrono::steady_clock::now())
+    {}
+
+    // record the current time under the given name
+    void Timeline::mark(const std::string & name)
+    {
+        if(enabled)
+            marks.push_back(std::make_pair(name, std::chrono::steady_clock::now()));
+    }
+
+    // print each mark, with time since the previous mark and since the timeline was created
+    void Timeline::print(std::ostream & out) const
+    {
+        typedef std::chrono::duration<double, std::milli> ms;
+        auto prev = start;
+
+        out<<std::fixed<<std::setprecision(2);
+        out<<std::setw(10)<<"phase ms"<<std::setw(10)<<"total ms"<<"  event"<<std::endl;
+        for(auto & i: marks)
+        {
+            out<<std::setw(10)<<ms(i.second - prev).count()<<std::setw(10)<<ms(i.second - start).count()
+                <<"  "<<i.first<<std::endl;
+            prev = i.second;
+        }
+    }
+}
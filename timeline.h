@@ -0,0 +1,39 @@
+// timeline.h
+// named timestamps for measuring startup time
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_TIMELINE_H
+#define MANCALA_TIMELINE_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Mancala
+{
+    class Timeline
+    {
+    public:
+        Timeline();
+
+        // record the current time under the given name
+        void mark(const std::string & name);
+
+        // print each mark, with time since the previous mark and since the timeline was created
+        void print(std::ostream & out) const;
+
+        // marks are ignored unless enabled
+        bool enabled;
+
+    private:
+        std::chrono::steady_clock::time_point start;
+        std::vector<std::pair<std::string, std::chrono::steady_clock::time_point>> marks;
+    };
+
+    // created at program start. enabled with --startup-times
+    extern Timeline startup_timeline;
+}
+
+#endif // MANCALA_TIMELINE_H
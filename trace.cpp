@@ -0,0 +1,104 @@
+// trace.cpp
+// timed spans written as Chrome trace event JSON
+// Copyright Matthew Chandler 2014
+
+#include <fstream>
+#include <iostream>
+
+#include "trace.h"
+
+namespace Mancala
+{
+    Trace trace;
+
+    // stop recording at this many spans, so a long session can't use up memory
+    const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    Trace::Trace():
+        on(false),
+        start(std::chrono::steady_clock::now())
+    {}
+
+    // writes the file if enabled
+    Trace::~Trace()
+    {
+        if(enabled() && !write(path))
+            std::cerr<<"could not write trace to "<<path<<std::endl;
+    }
+
+    // start recording, to be written to path at exit
+    void Trace::enable(const std::string & trace_path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        path = trace_path;
+        on = true;
+    }
+
+    // record a span on the calling thread
+    void Trace::span(const char * name, const std::chrono::steady_clock::time_point & begin,
+        const std::chrono::steady_clock::time_point & end, const char * arg_name, const long long arg)
+    {
+        typedef std::chrono::microseconds us;
+        std::lock_guard<std::mutex> lock(mutex);
+        if(events.size() >= MAX_TRACE_EVENTS)
+            return;
+        Event event;
+        event.name = name;
+        event.arg_name = arg_name;
+        event.arg = arg;
+        event.begin_us = std::chrono::duration_cast<us>(begin - start).count();
+        event.dur_us = std::chrono::duration_cast<us>(end - begin).count();
+        event.tid = thread_index();
+        events.push_back(event);
+    }
+
+    // label the calling thread in the trace viewer
+    void Trace::name_thread(const std::string & name)
+    {
+        if(!enabled())
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_names[thread_index()] = name;
+    }
+
+    // small id for the calling thread. mutex must be held
+    int Trace::thread_index()
+    {
+        auto id = thread_ids.find(std::this_thread::get_id());
+        if(id != thread_ids.end())
+            return id->second;
+        int index = thread_ids.size() + 1;
+        thread_ids[std::this_thread::get_id()] = index;
+        return index;
+    }
+
+    // write everything recorded so far. returns false on failure
+    bool Trace::write(const std::string & path) const
+    {
+        std::ofstream out(path.c_str());
+        if(!out)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        // names are all literals or our own thread names, so nothing needs escaping
+        out<<"{\"traceEvents\":[\n";
+        bool first = true;
+        for(auto & i: thread_names)
+        {
+            out<<(first? "": ",\n")<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<i.first
+                <<",\"args\":{\"name\":\""<<i.second<<"\"}}";
+            first = false;
+        }
+        for(auto & i: events)
+        {
+            out<<(first? "": ",\n")<<"{\"name\":\""<<i.name<<"\",\"ph\":\"X\",\"pid\":1,\"tid\":"<<i.tid
+                <<",\"ts\":"<<i.begin_us<<",\"dur\":"<<i.dur_us;
+            if(i.arg_name)
+                out<<",\"args\":{\""<<i.arg_name<<"\":"<<i.arg<<"}";
+            out<<"}";
+            first = false;
+        }
+        out<<"\n],\"displayTimeUnit\":\"ms\"}\n";
+        return bool(out);
+    }
+}
@@ -0,0 +1,98 @@
+// trace.h
+// timed spans written as Chrome trace event JSON
+// Copyright Matthew Chandler 2014
+
+#ifndef MANCALA_TRACE_H
+#define MANCALA_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Mancala
+{
+    // collects spans from any thread, and writes them in the Chrome trace event format
+    // the file can be opened in chrome://tracing or ui.perfetto.dev
+    class Trace
+    {
+    public:
+        Trace();
+        // writes the file if enabled
+        ~Trace();
+
+        // start recording, to be written to path at exit. spans are ignored until then
+        void enable(const std::string & trace_path);
+        bool enabled() const
+        {
+            return on.load(std::memory_order_relaxed);
+        }
+
+        // record a span on the calling thread. name and arg_name must be string literals
+        // arg_name may be NULL for no argument
+        void span(const char * name, const std::chrono::steady_clock::time_point & begin,
+            const std::chrono::steady_clock::time_point & end, const char * arg_name = NULL, const long long arg = 0);
+        // label the calling thread in the trace viewer
+        void name_thread(const std::string & name);
+
+        // write everything recorded so far. returns false on failure
+        bool write(const std::string & path) const;
+
+    private:
+        struct Event
+        {
+            const char * name;
+            const char * arg_name;
+            long long arg;
+            std::int64_t begin_us, dur_us;
+            int tid;
+        };
+
+        // small id for the calling thread. mutex must be held
+        int thread_index();
+
+        std::atomic<bool> on;
+        std::string path;
+        std::chrono::steady_clock::time_point start;
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        std::map<std::thread::id, int> thread_ids;
+        std::map<int, std::string> thread_names;
+    };
+
+    // created at program start. enabled with --trace
+    extern Trace trace;
+
+    // records a span from construction to destruction. costs one relaxed load when tracing is off
+    class Trace_span
+    {
+    public:
+        explicit Trace_span(const char * Name, const char * Arg_name = NULL, const long long Arg = 0):
+            name(Name), arg_name(Arg_name), arg(Arg), active(trace.enabled())
+        {
+            if(active)
+                begin = std::chrono::steady_clock::now();
+        }
+        ~Trace_span()
+        {
+            if(active)
+                trace.span(name, begin, std::chrono::steady_clock::now(), arg_name, arg);
+        }
+
+    private:
+        Trace_span(const Trace_span &);
+        Trace_span & operator=(const Trace_span &);
+
+        const char * name;
+        const char * arg_name;
+        long long arg;
+        bool active;
+        std::chrono::steady_clock::time_point begin;
+    };
+}
+
+#endif // MANCALA_TRACE_H